@@ -0,0 +1,59 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_CTRL_H_
+#define _PSP2_CTRL_H_
+
+#include <psp2/types.h>
+
+typedef enum SceCtrlButtons {
+    SCE_CTRL_SELECT   = 0x00000001,
+    SCE_CTRL_L3       = 0x00000002,
+    SCE_CTRL_R3       = 0x00000004,
+    SCE_CTRL_START    = 0x00000008,
+    SCE_CTRL_UP       = 0x00000010,
+    SCE_CTRL_RIGHT    = 0x00000020,
+    SCE_CTRL_DOWN     = 0x00000040,
+    SCE_CTRL_LEFT     = 0x00000080,
+    SCE_CTRL_LTRIGGER = 0x00000100,
+    SCE_CTRL_RTRIGGER = 0x00000200,
+    SCE_CTRL_L1       = 0x00000400,
+    SCE_CTRL_R1       = 0x00000800,
+    SCE_CTRL_TRIANGLE = 0x00001000,
+    SCE_CTRL_CIRCLE   = 0x00002000,
+    SCE_CTRL_CROSS    = 0x00004000,
+    SCE_CTRL_SQUARE   = 0x00008000
+} SceCtrlButtons;
+
+typedef enum SceCtrlPadInputMode {
+    SCE_CTRL_MODE_DIGITAL     = 0,
+    SCE_CTRL_MODE_ANALOG      = 1,
+    SCE_CTRL_MODE_ANALOG_WIDE = 2
+} SceCtrlPadInputMode;
+
+typedef struct SceCtrlData {
+    SceUInt64 timeStamp;
+    unsigned int buttons;
+    unsigned char lx;
+    unsigned char ly;
+    unsigned char rx;
+    unsigned char ry;
+    uint8_t up;
+    uint8_t right;
+    uint8_t down;
+    uint8_t left;
+    uint8_t lt;
+    uint8_t rt;
+    uint8_t l1;
+    uint8_t r1;
+    uint8_t triangle;
+    uint8_t circle;
+    uint8_t cross;
+    uint8_t square;
+    uint8_t reserved[4];
+} SceCtrlData;
+
+int sceCtrlSetSamplingMode(SceCtrlPadInputMode mode);
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad_data, int count);
+
+#endif
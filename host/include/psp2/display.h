@@ -0,0 +1,33 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_DISPLAY_H_
+#define _PSP2_DISPLAY_H_
+
+#include <psp2/types.h>
+
+typedef enum SceDisplayPixelFormat {
+    SCE_DISPLAY_PIXELFORMAT_A8B8G8R8 = 0x00000000U
+} SceDisplayPixelFormat;
+
+typedef enum SceDisplaySetBufSync {
+    SCE_DISPLAY_SETBUF_IMMEDIATE = 0,
+    SCE_DISPLAY_SETBUF_NEXTFRAME = 1
+} SceDisplaySetBufSync;
+
+typedef struct SceDisplayFrameBuf {
+    SceSize size;
+    void *base;
+    unsigned int pitch;
+    unsigned int pixelformat;
+    unsigned int width;
+    unsigned int height;
+} SceDisplayFrameBuf;
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, SceDisplaySetBufSync sync);
+int sceDisplayWaitVblankStart(void);
+int sceDisplayWaitVblankStartMulti(unsigned int vcount);
+int sceDisplayGetVcount(void);
+int sceDisplayGetRefreshRate(float *pFps);
+
+#endif
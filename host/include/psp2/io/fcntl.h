@@ -0,0 +1,29 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_IO_FCNTL_H_
+#define _PSP2_IO_FCNTL_H_
+
+#include <psp2/types.h>
+
+#define SCE_O_RDONLY 0x0001
+#define SCE_O_WRONLY 0x0002
+#define SCE_O_RDWR   (SCE_O_RDONLY | SCE_O_WRONLY)
+#define SCE_O_APPEND 0x0100
+#define SCE_O_CREAT  0x0200
+#define SCE_O_TRUNC  0x0400
+
+#define SCE_SEEK_SET 0
+#define SCE_SEEK_CUR 1
+#define SCE_SEEK_END 2
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void *buf, SceSize nbyte);
+int sceIoWrite(SceUID fd, const void *buf, SceSize nbyte);
+int sceIoPread(SceUID fd, void *data, SceSize size, SceOff offset);
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+int sceIoRemove(const char *file);
+int sceIoRename(const char *oldname, const char *newname);
+
+#endif
@@ -0,0 +1,11 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_IO_STAT_H_
+#define _PSP2_IO_STAT_H_
+
+#include <psp2/types.h>
+
+int sceIoMkdir(const char *dir, SceMode mode);
+
+#endif
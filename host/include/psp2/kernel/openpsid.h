@@ -0,0 +1,15 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_KERNEL_OPENPSID_H_
+#define _PSP2_KERNEL_OPENPSID_H_
+
+#include <psp2/types.h>
+
+typedef struct SceKernelOpenPsId {
+    char id[16];
+} SceKernelOpenPsId;
+
+int sceKernelGetOpenPsId(SceKernelOpenPsId *id);
+
+#endif
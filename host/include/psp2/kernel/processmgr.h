@@ -0,0 +1,20 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_KERNEL_PROCESSMGR_H_
+#define _PSP2_KERNEL_PROCESSMGR_H_
+
+#include <psp2/types.h>
+
+typedef enum SceKernelPowerTickType {
+    SCE_KERNEL_POWER_TICK_DEFAULT              = 0,
+    SCE_KERNEL_POWER_TICK_DISABLE_AUTO_SUSPEND = 1,
+    SCE_KERNEL_POWER_TICK_DISABLE_OLED_OFF     = 4,
+    SCE_KERNEL_POWER_TICK_DISABLE_OLED_DIMMING = 6
+} SceKernelPowerTickType;
+
+int sceKernelExitProcess(int res);
+int sceKernelPowerTick(SceKernelPowerTickType type);
+SceUInt64 sceKernelGetProcessTimeWide(void);
+
+#endif
@@ -0,0 +1,46 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_KERNEL_THREADMGR_H_
+#define _PSP2_KERNEL_THREADMGR_H_
+
+#include <psp2/types.h>
+
+#define SCE_KERNEL_HIGHEST_PRIORITY_USER 64
+#define SCE_KERNEL_LOWEST_PRIORITY_USER  191
+#define SCE_KERNEL_DEFAULT_PRIORITY_USER 0x10000100
+
+#define SCE_KERNEL_CPU_MASK_USER_0 0x00010000
+#define SCE_KERNEL_CPU_MASK_USER_1 0x00020000
+#define SCE_KERNEL_CPU_MASK_USER_2 0x00040000
+
+typedef struct SceKernelThreadOptParam SceKernelThreadOptParam;
+typedef struct SceKernelSemaOptParam SceKernelSemaOptParam;
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+typedef int (*SceKernelCallbackFunction)(int notifyId, int notifyCount, int notifyArg, void *common);
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority,
+                             SceSize stackSize, SceUInt attr, int cpuAffinityMask,
+                             const SceKernelThreadOptParam *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelDelayThread(SceUInt delay);
+int sceKernelDelayThreadCB(SceUInt delay);
+int sceKernelSleepThreadCB(void);
+
+SceUID sceKernelCreateCallback(const char *name, unsigned int attr, SceKernelCallbackFunction func,
+                               void *arg);
+int sceKernelDeleteCallback(SceUID cb);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal,
+                           SceKernelSemaOptParam *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+int sceKernelPollSema(SceUID semaid, int signal);
+
+SceUInt64 sceKernelGetSystemTimeWide(void);
+
+#endif
@@ -0,0 +1,18 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_POWER_H_
+#define _PSP2_POWER_H_
+
+#include <psp2/types.h>
+
+typedef enum ScePowerCallbackType {
+    SCE_POWER_CB_SUSPENDING      = 0x00010000,
+    SCE_POWER_CB_RESUMING        = 0x00020000,
+    SCE_POWER_CB_RESUME_COMPLETE = 0x00040000,
+} ScePowerCallbackType;
+
+int scePowerRegisterCallback(SceUID cbid);
+int scePowerUnregisterCallback(SceUID cbid);
+
+#endif
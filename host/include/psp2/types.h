@@ -0,0 +1,21 @@
+// Host stand-in for the VitaSDK header of the same name (see host/sce_shim.c).
+// Only the declarations the application uses are provided.
+
+#ifndef _PSP2_TYPES_H_
+#define _PSP2_TYPES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t SceUID;
+typedef unsigned int SceSize;
+typedef unsigned int SceUInt;
+typedef int SceMode;
+typedef int SceBool;
+typedef int64_t SceOff;
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef int64_t SceInt64;
+typedef uint64_t SceUInt64;
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Host tool for asset packs (src/pack.h).
+ *
+ * Usage: pack_tool create OUT DIR
+ *          Pack every file under DIR; entry names are paths relative to
+ *          DIR. Binary PPM images (.ppm) become pixels, RLE compressed when
+ *          that is smaller; every other file is stored as is.
+ *        pack_tool list PACK
+ *          Map the pack, check it the way the application does and verify
+ *          the checksum of every entry.
+ */
+
+#define _GNU_SOURCE
+
+#include "pack.h"
+#include "rle.h"
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_FILES 4096
+
+typedef struct {
+    char name[PACK_NAME_SIZE];
+    char path[4096];
+} InputFile;
+
+static InputFile files[MAX_FILES];
+static int file_count = 0;
+static size_t root_len = 0;
+
+// ============================================
+// Input
+// ============================================
+
+static int collect(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type != FTW_F) return 0;
+    const char *name = path + root_len;
+    while (*name == '/') name++;
+    if (strlen(name) >= PACK_NAME_SIZE) {
+        fprintf(stderr, "pack_tool: name too long (max %d): %s\n", PACK_NAME_SIZE - 1, name);
+        return 1;
+    }
+    if (file_count == MAX_FILES) {
+        fprintf(stderr, "pack_tool: more than %d files\n", MAX_FILES);
+        return 1;
+    }
+    snprintf(files[file_count].name, PACK_NAME_SIZE, "%s", name);
+    snprintf(files[file_count].path, sizeof(files[file_count].path), "%s", path);
+    file_count++;
+    return 0;
+}
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const InputFile *)a)->name, ((const InputFile *)b)->name);
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)length;
+    return data;
+}
+
+// Next header field of a PPM, skipping whitespace and comments
+static int ppm_field(const uint8_t *data, size_t size, size_t *pos) {
+    while (*pos < size) {
+        if (data[*pos] == '#') {
+            while (*pos < size && data[*pos] != '\n') (*pos)++;
+        } else if (data[*pos] == ' ' || data[*pos] == '\t' || data[*pos] == '\r' || data[*pos] == '\n') {
+            (*pos)++;
+        } else {
+            break;
+        }
+    }
+    int value = 0;
+    int digits = 0;
+    while (*pos < size && data[*pos] >= '0' && data[*pos] <= '9' && digits < 6) {
+        value = value * 10 + (data[(*pos)++] - '0');
+        digits++;
+    }
+    return digits ? value : -1;
+}
+
+// Convert a binary PPM to pixels; returns NULL if it is not one
+static uint32_t *ppm_pixels(const uint8_t *data, size_t size, int *width, int *height) {
+    if (size < 2 || data[0] != 'P' || data[1] != '6') return NULL;
+    size_t pos = 2;
+    int w = ppm_field(data, size, &pos);
+    int h = ppm_field(data, size, &pos);
+    int max = ppm_field(data, size, &pos);
+    pos++;    // Single whitespace before the raster
+    if (w <= 0 || h <= 0 || w > 0xFFFF || h > 0xFFFF || max != 255) return NULL;
+    if (size - pos < (size_t)w * h * 3) return NULL;
+
+    uint32_t *pixels = malloc((size_t)w * h * sizeof(uint32_t));
+    if (!pixels) return NULL;
+    const uint8_t *rgb = data + pos;
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        pixels[i] = 0xFF000000 | ((uint32_t)rgb[2] << 16) | ((uint32_t)rgb[1] << 8) | rgb[0];
+        rgb += 3;
+    }
+    *width = w;
+    *height = h;
+    return pixels;
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t n = strlen(name);
+    size_t s = strlen(suffix);
+    return n >= s && strcmp(name + n - s, suffix) == 0;
+}
+
+// ============================================
+// Commands
+// ============================================
+
+static int create_pack(const char *out_path, const char *dir) {
+    root_len = strlen(dir);
+    if (nftw(dir, collect, 16, FTW_PHYS) != 0) {
+        fprintf(stderr, "pack_tool: cannot read %s\n", dir);
+        return 1;
+    }
+    qsort(files, file_count, sizeof(files[0]), compare_files);
+
+    PackEntry *toc = calloc(file_count ? file_count : 1, sizeof(PackEntry));
+    uint8_t **blobs = calloc(file_count ? file_count : 1, sizeof(uint8_t *));
+    if (!toc || !blobs) return 1;
+
+    uint32_t offset = sizeof(PackHeader) + file_count * sizeof(PackEntry);
+    for (int i = 0; i < file_count; i++) {
+        size_t size;
+        uint8_t *data = read_file(files[i].path, &size);
+        if (!data) {
+            fprintf(stderr, "pack_tool: cannot read %s\n", files[i].path);
+            return 1;
+        }
+
+        PackEntry *e = &toc[i];
+        memcpy(e->name, files[i].name, PACK_NAME_SIZE);
+        e->encoding = PACK_DATA;
+
+        int w, h;
+        uint32_t *pixels = has_suffix(e->name, ".ppm") ? ppm_pixels(data, size, &w, &h) : NULL;
+        if (pixels) {
+            size_t raw = (size_t)w * h * sizeof(uint32_t);
+            uint8_t *rle = malloc(raw);
+            size_t rle_size = rle ? rle_encode(pixels, w, h, w, rle, raw) : 0;
+            free(data);
+            e->width = (uint16_t)w;
+            e->height = (uint16_t)h;
+            if (rle_size > 0 && rle_size < raw) {
+                free(pixels);
+                data = rle;
+                size = rle_size;
+                e->encoding = PACK_RLE;
+            } else {
+                free(rle);
+                data = (uint8_t *)pixels;
+                size = raw;
+                e->encoding = PACK_PIXELS;
+            }
+        }
+
+        offset = (offset + PACK_ALIGN - 1) & ~(uint32_t)(PACK_ALIGN - 1);
+        e->offset = offset;
+        e->size = (uint32_t)size;
+        e->checksum = pack_checksum(data, (uint32_t)size);
+        blobs[i] = data;
+        // Keep a zero byte after every entry
+        offset += (uint32_t)size + 1;
+    }
+    uint32_t file_size = (offset + PACK_ALIGN - 1) & ~(uint32_t)(PACK_ALIGN - 1);
+
+    uint8_t *image = calloc(1, file_size);
+    if (!image) return 1;
+    PackHeader header = {
+        .magic = PACK_MAGIC,
+        .version = PACK_VERSION,
+        .entry_count = (uint32_t)file_count,
+        .file_size = file_size,
+    };
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + sizeof(header), toc, file_count * sizeof(PackEntry));
+    for (int i = 0; i < file_count; i++) {
+        memcpy(image + toc[i].offset, blobs[i], toc[i].size);
+        free(blobs[i]);
+    }
+
+    Pack check;
+    if (pack_open(&check, image, file_size) < 0) {
+        fprintf(stderr, "pack_tool: built pack does not validate\n");
+        return 1;
+    }
+
+    FILE *f = fopen(out_path, "wb");
+    if (!f || fwrite(image, 1, file_size, f) != file_size || fclose(f) != 0) {
+        fprintf(stderr, "pack_tool: cannot write %s\n", out_path);
+        return 1;
+    }
+    printf("%s: %d entries, %u bytes\n", out_path, file_count, (unsigned)file_size);
+    free(image);
+    free(blobs);
+    free(toc);
+    return 0;
+}
+
+static const char *encoding_name(int encoding) {
+    switch (encoding) {
+        case PACK_DATA:   return "data";
+        case PACK_PIXELS: return "pixels";
+        case PACK_RLE:    return "rle";
+        default:          return "?";
+    }
+}
+
+static int list_pack(const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "pack_tool: cannot open %s\n", path);
+        return 1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "pack_tool: cannot map %s\n", path);
+        return 1;
+    }
+
+    Pack pack;
+    if (pack_open(&pack, base, (uint32_t)st.st_size) < 0) {
+        fprintf(stderr, "pack_tool: %s is not a valid pack\n", path);
+        munmap(base, (size_t)st.st_size);
+        return 1;
+    }
+
+    int bad = 0;
+    printf("%-40s %-6s %10s %10s %9s  %s\n", "name", "type", "offset", "size", "image", "checksum");
+    for (uint32_t i = 0; i < pack.count; i++) {
+        const PackEntry *e = &pack.toc[i];
+        int ok = pack_checksum(pack_data(&pack, e), e->size) == e->checksum;
+        char image[16] = "";
+        if (e->encoding != PACK_DATA) snprintf(image, sizeof(image), "%ux%u", e->width, e->height);
+        printf("%-40s %-6s %10u %10u %9s  %08x %s\n", e->name, encoding_name(e->encoding),
+               (unsigned)e->offset, (unsigned)e->size, image, (unsigned)e->checksum, ok ? "ok" : "BAD");
+        bad += !ok;
+    }
+    printf("%u entries, %u bytes\n", (unsigned)pack.count, (unsigned)pack.size);
+    munmap(base, (size_t)st.st_size);
+    return bad ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "create") == 0) return create_pack(argv[2], argv[3]);
+    if (argc == 3 && strcmp(argv[1], "list") == 0) return list_pack(argv[2]);
+    fprintf(stderr, "usage: pack_tool create OUT DIR\n       pack_tool list PACK\n");
+    return 2;
+}
@@ -0,0 +1,266 @@
+/*
+ * Host benchmark for the pattern painters and the text renderer.
+ *
+ * Paints every registry pattern over a full screen-sized buffer (cycling
+ * through the states of animated patterns) and reports wall-clock time
+ * together with hardware counters read through perf_event_open: cycles,
+ * instructions, last-level cache misses and branch misses. Counts are
+ * normalized per painted pixel so painters of different kinds can be
+ * compared directly. Counters the kernel or CPU does not provide (no PMU
+ * in a VM, perf_event_paranoid, seccomp) are reported as unavailable and
+ * the timings are still printed.
+ *
+ * Usage: pattern_bench [-n FRAMES] [NAME...]
+ *   -n FRAMES   frames painted per pattern (default 60)
+ *   NAME        only run patterns whose name contains NAME (case-insensitive);
+ *               "text" selects the text renderer cases
+ */
+
+#define _GNU_SOURCE
+
+#include "display.h"
+#include "font.h"
+#include "patterns.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_FRAMES 60
+
+typedef enum { CTR_CYCLES, CTR_INSTRUCTIONS, CTR_CACHE_MISSES, CTR_BRANCH_MISSES, CTR_COUNT } CounterId;
+
+typedef struct {
+    const char *name;
+    uint64_t config;
+    int fd;
+} Counter;
+
+static Counter counters[CTR_COUNT] = {
+    {"cycles",        PERF_COUNT_HW_CPU_CYCLES,       -1},
+    {"instructions",  PERF_COUNT_HW_INSTRUCTIONS,     -1},
+    {"cache-misses",  PERF_COUNT_HW_CACHE_MISSES,     -1},
+    {"branch-misses", PERF_COUNT_HW_BRANCH_MISSES,    -1},
+};
+
+typedef struct {
+    uint64_t ns;
+    uint64_t pixels;
+    double counts[CTR_COUNT];    // Scaled for multiplexing; < 0 if unavailable
+} Sample;
+
+// One benchmark case paints `frame` into pixels and returns the pixels it touched
+typedef uint64_t (*CaseFn)(uint32_t *pixels, int index, int frame);
+
+// ============================================
+// Counters
+// ============================================
+
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Returns the number of counters that could be opened
+static int counters_open(void) {
+    int opened = 0;
+    int first_error = 0;
+    for (int i = 0; i < CTR_COUNT; i++) {
+        counters[i].fd = open_counter(counters[i].config);
+        if (counters[i].fd >= 0) {
+            opened++;
+        } else if (!first_error) {
+            first_error = errno;
+        }
+    }
+
+    if (opened == 0) {
+        fprintf(stderr, "pattern_bench: hardware counters unavailable (%s), timings only\n",
+                strerror(first_error));
+        if (first_error == EACCES || first_error == EPERM) {
+            fprintf(stderr, "pattern_bench: see /proc/sys/kernel/perf_event_paranoid\n");
+        }
+    } else if (opened < CTR_COUNT) {
+        for (int i = 0; i < CTR_COUNT; i++) {
+            if (counters[i].fd < 0) fprintf(stderr, "pattern_bench: %s not counted\n", counters[i].name);
+        }
+    }
+    return opened;
+}
+
+static void counters_start(void) {
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (counters[i].fd < 0) continue;
+        ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static void counters_stop(double counts[CTR_COUNT]) {
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (counters[i].fd >= 0) ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int i = 0; i < CTR_COUNT; i++) {
+        uint64_t value[3];    // count, time enabled, time running
+        counts[i] = -1;
+        if (counters[i].fd < 0 || read(counters[i].fd, value, sizeof(value)) != sizeof(value)) continue;
+        if (value[2] == 0) continue;   // Never scheduled onto the PMU
+        counts[i] = (double)value[0] * ((double)value[1] / (double)value[2]);
+    }
+}
+
+static void counters_close(void) {
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (counters[i].fd >= 0) close(counters[i].fd);
+        counters[i].fd = -1;
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ============================================
+// Cases
+// ============================================
+
+static const Rect full_screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+static uint64_t paint_pattern(uint32_t *pixels, int index, int frame) {
+    const PatternDesc *desc = pattern_get(index);
+    PatternArgs args;
+    pattern_default_args(desc, &args);
+    pattern_render(pixels, &full_screen, desc, &args, frame % desc->cycle);
+    return (uint64_t)SCREEN_WIDTH * SCREEN_HEIGHT;
+}
+
+// Text cases: a screenful of HUD-sized lines (scale 1) or indicator-sized
+// lines (scale 3); pixels are the glyph cells covered
+static const int text_scales[] = {1, 3};
+
+static uint64_t paint_text(uint32_t *pixels, int index, int frame) {
+    static const char line[] = "PATTERN Gradient Rotate  RENDER 1234 us  FRAME 16683 us";
+    int scale = text_scales[index];
+    int line_h = 8 * scale;
+    int chars = (int)(sizeof(line) - 1);
+    uint64_t covered = 0;
+    (void)frame;
+    for (int y = 0; y + line_h <= SCREEN_HEIGHT; y += line_h) {
+        draw_string(pixels, 0, y, line, scale, COLOR_WHITE, 0, 0);
+        covered += (uint64_t)chars * 4 * 6 * scale * scale;
+    }
+    return covered;
+}
+
+static Sample run_case(CaseFn fn, int index, uint32_t *pixels, int frames) {
+    Sample s = {0};
+    fn(pixels, index, 0);    // Warm caches and tables
+
+    counters_start();
+    uint64_t start = now_ns();
+    for (int f = 0; f < frames; f++) {
+        s.pixels += fn(pixels, index, f);
+    }
+    s.ns = now_ns() - start;
+    counters_stop(s.counts);
+    return s;
+}
+
+// ============================================
+// Report
+// ============================================
+
+static void print_header(void) {
+    printf("%-18s %10s %8s %8s %8s %6s %10s %10s\n", "case", "us/frame", "ns/px", "cyc/px", "ins/px",
+           "IPC", "llc/kpx", "brmiss/kpx");
+}
+
+static void print_per_pixel(double count, double pixels, double scale) {
+    if (count < 0) {
+        printf(" %*s", scale > 1 ? 10 : 8, "-");
+    } else if (scale > 1) {
+        printf(" %10.3f", count * scale / pixels);
+    } else {
+        printf(" %8.3f", count / pixels);
+    }
+}
+
+static void print_sample(const char *name, const Sample *s, int frames) {
+    double px = (double)s->pixels;
+    printf("%-18s %10.1f %8.3f", name, s->ns / 1000.0 / frames, s->ns / px);
+    print_per_pixel(s->counts[CTR_CYCLES], px, 1);
+    print_per_pixel(s->counts[CTR_INSTRUCTIONS], px, 1);
+    if (s->counts[CTR_CYCLES] > 0 && s->counts[CTR_INSTRUCTIONS] >= 0) {
+        printf(" %6.2f", s->counts[CTR_INSTRUCTIONS] / s->counts[CTR_CYCLES]);
+    } else {
+        printf(" %6s", "-");
+    }
+    print_per_pixel(s->counts[CTR_CACHE_MISSES], px, 1000);
+    print_per_pixel(s->counts[CTR_BRANCH_MISSES], px, 1000);
+    printf("\n");
+}
+
+static int selected(const char *name, char **filters, int filter_count) {
+    if (filter_count == 0) return 1;
+    for (int i = 0; i < filter_count; i++) {
+        if (strcasestr(name, filters[i])) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int frames = DEFAULT_FRAMES;
+    char *filters[64];
+    int filter_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+            if (frames < 1) frames = 1;
+        } else if (filter_count < (int)(sizeof(filters) / sizeof(filters[0]))) {
+            filters[filter_count++] = argv[i];
+        }
+    }
+
+    uint32_t *pixels = aligned_alloc(64, SCREEN_FB_SIZE);
+    if (!pixels) return 1;
+    memset(pixels, 0, SCREEN_FB_SIZE);
+    pattern_init_tables();
+    counters_open();
+
+    printf("%d frames per case, %dx%d\n", frames, SCREEN_WIDTH, SCREEN_HEIGHT);
+    print_header();
+    for (int p = 0; p < pattern_count(); p++) {
+        const char *name = pattern_get(p)->name;
+        if (!selected(name, filters, filter_count)) continue;
+        Sample s = run_case(paint_pattern, p, pixels, frames);
+        print_sample(name, &s, frames);
+    }
+    for (int t = 0; t < (int)(sizeof(text_scales) / sizeof(text_scales[0])); t++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Text x%d", text_scales[t]);
+        if (!selected(name, filters, filter_count)) continue;
+        Sample s = run_case(paint_text, t, pixels, frames);
+        print_sample(name, &s, frames);
+    }
+
+    counters_close();
+    free(pixels);
+    return 0;
+}
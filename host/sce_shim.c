@@ -0,0 +1,929 @@
+/*
+ * Host emulation of the SCE APIs used by Vita Screen Test.
+ *
+ * Implements display, controller, memory, thread, semaphore, callback,
+ * power and file APIs on top of POSIX so the unmodified application can run
+ * on Linux. The display is an in-memory scanout fed by a simulated 59.94 Hz
+ * vblank clock and the controller replays a script keyed by vblank count.
+ * The script can also put the system to sleep: power callbacks are
+ * notified and the clock jumps over the time spent suspended.
+ *
+ * Environment:
+ *   VITA_SHIM_MODE         "fast" (default) or "realtime"
+ *   VITA_SHIM_SCRIPT       controller script file (see README)
+ *   VITA_SHIM_ROOT         host directory that stands in for ux0: (default ./vita_fs)
+ *   VITA_SHIM_MAX_VBLANKS  stop the process after this many vblanks (0 = never)
+ *   VITA_SHIM_MAX_LATE     fail if more than this percentage of flips stayed
+ *                          on screen for two vblanks or more (unset = no limit)
+ *
+ * Exit status: the application's, 2 when VITA_SHIM_MAX_VBLANKS stopped it,
+ * 3 when it exited normally but frame pacing broke VITA_SHIM_MAX_LATE.
+ */
+
+#define _GNU_SOURCE
+
+#include <psp2/ctrl.h>
+#include <psp2/display.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/openpsid.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/power.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VBLANK_PERIOD_NS   16683350ULL  // 1 / 59.94 Hz
+#define SYSTEM_TIME_OFFSET 5000000ULL   // System time does not start at process start
+
+#define SCE_KERNEL_ERROR_ERROR         0x80020001
+#define SCE_KERNEL_ERROR_ILLEGAL_UID   0x80020000
+#define SCE_KERNEL_ERROR_WAIT_TIMEOUT  0x80028005
+#define SCE_KERNEL_ERROR_SEMA_ZERO     0x80028019
+#define SCE_KERNEL_ERROR_NO_MEMORY     0x80028004
+
+#define MAX_OBJECTS      256
+#define MAX_SCRIPT_LINES 1024
+#define PACING_BUCKETS   5
+#define MAX_POWER_CALLBACKS 4
+#define SUSPEND_GRACE_NS 50000000ULL  // Time apps get to react before the system sleeps
+
+// ============================================
+// Object table (UIDs)
+// ============================================
+
+typedef enum { OBJ_FREE, OBJ_MEMBLOCK, OBJ_THREAD, OBJ_SEMA, OBJ_FILE, OBJ_CALLBACK } ObjectKind;
+
+typedef struct {
+    pthread_t handle;
+    SceKernelThreadEntry entry;
+    void *args;
+    SceSize arglen;
+    int exit_status;
+    int started;
+} ShimThread;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+    int max;
+} ShimSema;
+
+typedef struct {
+    SceKernelCallbackFunction func;
+    void *arg;
+    pthread_t owner;          // Only this thread runs the callback
+    int notify_count;         // Notifications since the callback last ran
+    int notify_arg;
+} ShimCallback;
+
+typedef struct {
+    ObjectKind kind;
+    void *data;
+    int fd;
+} ShimObject;
+
+static ShimObject objects[MAX_OBJECTS];
+static pthread_mutex_t objects_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static SceUID new_object(ObjectKind kind, void *data) {
+    pthread_mutex_lock(&objects_lock);
+    for (int i = 1; i < MAX_OBJECTS; i++) {
+        if (objects[i].kind == OBJ_FREE) {
+            objects[i].kind = kind;
+            objects[i].data = data;
+            objects[i].fd = -1;
+            pthread_mutex_unlock(&objects_lock);
+            return 0x100 + i;
+        }
+    }
+    pthread_mutex_unlock(&objects_lock);
+    return SCE_KERNEL_ERROR_NO_MEMORY;
+}
+
+static ShimObject *get_object(SceUID uid, ObjectKind kind) {
+    int i = uid - 0x100;
+    if (i <= 0 || i >= MAX_OBJECTS || objects[i].kind != kind) return NULL;
+    return &objects[i];
+}
+
+static void free_object(SceUID uid) {
+    int i = uid - 0x100;
+    if (i <= 0 || i >= MAX_OBJECTS) return;
+    pthread_mutex_lock(&objects_lock);
+    objects[i].kind = OBJ_FREE;
+    objects[i].data = NULL;
+    pthread_mutex_unlock(&objects_lock);
+}
+
+// ============================================
+// Virtual clock
+// ============================================
+
+static int realtime_mode = 0;
+static uint64_t start_ns = 0;
+static uint64_t skipped_ns = 0;      // Time jumped over instead of slept (fast mode)
+static uint64_t max_vblanks = 0;
+static int max_late_percent = -1;    // -1: no pacing limit
+static pthread_t main_thread;
+static pthread_mutex_t clock_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t real_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t virtual_ns(void) {
+    pthread_mutex_lock(&clock_lock);
+    uint64_t now = real_ns() - start_ns + skipped_ns;
+    pthread_mutex_unlock(&clock_lock);
+    return now;
+}
+
+// Let virtual time pass: sleep in realtime mode, jump ahead in fast mode.
+// Only the main thread moves the clock; other threads always sleep.
+static void advance_ns(uint64_t ns) {
+    if (realtime_mode || !pthread_equal(pthread_self(), main_thread)) {
+        struct timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+        nanosleep(&ts, NULL);
+    } else {
+        pthread_mutex_lock(&clock_lock);
+        skipped_ns += ns;
+        pthread_mutex_unlock(&clock_lock);
+    }
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void) {
+    return virtual_ns() / 1000;
+}
+
+SceUInt64 sceKernelGetSystemTimeWide(void) {
+    return virtual_ns() / 1000 + SYSTEM_TIME_OFFSET;
+}
+
+// ============================================
+// Controller script
+// ============================================
+
+typedef enum { CMD_PRESS, CMD_RELEASE, CMD_TAP, CMD_DUMP, CMD_SUSPEND, CMD_EXIT } ScriptCommand;
+
+typedef struct {
+    uint64_t vcount;
+    ScriptCommand command;
+    unsigned int buttons;
+    uint64_t duration_ns;
+    char path[128];
+} ScriptLine;
+
+static ScriptLine script[MAX_SCRIPT_LINES];
+static int script_count = 0;
+static int script_next = 0;
+static unsigned int held_buttons = 0;
+static unsigned int tap_release = 0;
+static uint64_t sample_time_us = 0;
+
+// The controller is sampled once per vblank and keeps the latest samples
+// in a ring, like the hardware buffer the Peek/Read calls return
+#define CTRL_BUFFERS 64
+static struct { unsigned int buttons; uint64_t time_us; } ctrl_ring[CTRL_BUFFERS];
+static uint64_t ctrl_samples = 0;
+
+static const struct { const char *name; unsigned int mask; } button_names[] = {
+    {"SELECT", SCE_CTRL_SELECT}, {"START", SCE_CTRL_START}, {"UP", SCE_CTRL_UP},
+    {"RIGHT", SCE_CTRL_RIGHT}, {"DOWN", SCE_CTRL_DOWN}, {"LEFT", SCE_CTRL_LEFT},
+    {"L", SCE_CTRL_LTRIGGER}, {"R", SCE_CTRL_RTRIGGER}, {"TRIANGLE", SCE_CTRL_TRIANGLE},
+    {"CIRCLE", SCE_CTRL_CIRCLE}, {"CROSS", SCE_CTRL_CROSS}, {"SQUARE", SCE_CTRL_SQUARE},
+};
+
+static unsigned int parse_buttons(char *list) {
+    unsigned int mask = 0;
+    for (char *tok = strtok(list, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+        int found = 0;
+        for (size_t i = 0; i < sizeof(button_names) / sizeof(button_names[0]); i++) {
+            if (strcasecmp(tok, button_names[i].name) == 0) {
+                mask |= button_names[i].mask;
+                found = 1;
+            }
+        }
+        if (!found) fprintf(stderr, "shim: unknown button '%s'\n", tok);
+    }
+    return mask;
+}
+
+static void load_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "shim: cannot open script %s\n", path);
+        exit(1);
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) && script_count < MAX_SCRIPT_LINES) {
+        unsigned long long vcount;
+        char command[16];
+        int used;
+        if (line[0] == '#' || sscanf(line, "%llu %15s %n", &vcount, command, &used) < 2) continue;
+
+        ScriptLine *s = &script[script_count];
+        memset(s, 0, sizeof(*s));
+        s->vcount = vcount;
+        if (strcasecmp(command, "press") == 0) {
+            s->command = CMD_PRESS;
+            s->buttons = parse_buttons(line + used);
+        } else if (strcasecmp(command, "release") == 0) {
+            s->command = CMD_RELEASE;
+            s->buttons = parse_buttons(line + used);
+            if (s->buttons == 0) s->buttons = ~0u;
+        } else if (strcasecmp(command, "tap") == 0) {
+            s->command = CMD_TAP;
+            s->buttons = parse_buttons(line + used);
+        } else if (strcasecmp(command, "dump") == 0) {
+            s->command = CMD_DUMP;
+            sscanf(line + used, "%127s", s->path);
+        } else if (strcasecmp(command, "suspend") == 0) {
+            double seconds = 0;
+            s->command = CMD_SUSPEND;
+            sscanf(line + used, "%lf", &seconds);
+            s->duration_ns = (uint64_t)(seconds * 1e9);
+        } else if (strcasecmp(command, "exit") == 0) {
+            s->command = CMD_EXIT;
+        } else {
+            fprintf(stderr, "shim: unknown script command '%s'\n", command);
+            continue;
+        }
+        script_count++;
+    }
+    fclose(f);
+}
+
+int sceCtrlSetSamplingMode(SceCtrlPadInputMode mode) {
+    (void)mode;
+    return 0;
+}
+
+// ============================================
+// Display
+// ============================================
+
+static SceDisplayFrameBuf scanout;
+static SceDisplayFrameBuf pending;
+static int pending_valid = 0;
+static uint64_t vcount = 0;
+static uint64_t last_flip_vcount = 0;
+static uint64_t flips = 0;
+static uint64_t pacing[PACING_BUCKETS];
+static uint64_t first_flip_ns = 0;
+static int flipped_since_vblank = 0;
+
+static void dump_scanout(const char *name) {
+    if (!scanout.base) return;
+    FILE *f = fopen(name, "wb");
+    if (!f) return;
+    fprintf(f, "P6\n%u %u\n255\n", scanout.width, scanout.height);
+    const uint32_t *pixels = (const uint32_t *)scanout.base;
+    for (unsigned y = 0; y < scanout.height; y++) {
+        for (unsigned x = 0; x < scanout.width; x++) {
+            uint32_t c = pixels[y * scanout.pitch + x];
+            unsigned char rgb[3] = {c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF};
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+    fclose(f);
+}
+
+static void print_report(void) {
+    double seconds = (virtual_ns() - first_flip_ns) / 1e9;
+    fprintf(stderr, "shim: %llu vblanks, %llu flips, %.2f s virtual, mode %s\n",
+            (unsigned long long)vcount, (unsigned long long)flips, seconds,
+            realtime_mode ? "realtime" : "fast");
+    fprintf(stderr, "shim: frames held for 1/2/3/4/5+ vblanks: %llu %llu %llu %llu %llu\n",
+            (unsigned long long)pacing[0], (unsigned long long)pacing[1],
+            (unsigned long long)pacing[2], (unsigned long long)pacing[3],
+            (unsigned long long)pacing[4]);
+}
+
+// Status to exit with once the application finished with status res
+static int final_status(int res) {
+    uint64_t late = 0;
+    for (int i = 1; i < PACING_BUCKETS; i++) late += pacing[i];
+    if (res != 0 || max_late_percent < 0 || late * 100 <= flips * (uint64_t)max_late_percent) return res;
+    fprintf(stderr, "shim: %llu of %llu flips were late, limit %d%%\n",
+            (unsigned long long)late, (unsigned long long)flips, max_late_percent);
+    return 3;
+}
+
+static void record_flip(void) {
+    if (flips > 0) {
+        uint64_t held = vcount - last_flip_vcount;
+        if (held >= 1) pacing[(held > PACING_BUCKETS ? PACING_BUCKETS : held) - 1]++;
+    } else {
+        first_flip_ns = virtual_ns();
+    }
+    last_flip_vcount = vcount;
+    flips++;
+}
+
+static void start_suspend(uint64_t duration_ns);
+
+// Everything that happens at the start of vblank number vcount
+static void on_vblank(void) {
+    vcount++;
+    flipped_since_vblank = 0;
+    sample_time_us = sceKernelGetSystemTimeWide();
+
+    if (pending_valid) {
+        scanout = pending;
+        pending_valid = 0;
+        record_flip();
+    }
+
+    held_buttons &= ~tap_release;
+    tap_release = 0;
+    while (script_next < script_count && script[script_next].vcount <= vcount) {
+        ScriptLine *s = &script[script_next++];
+        switch (s->command) {
+            case CMD_PRESS:   held_buttons |= s->buttons; break;
+            case CMD_RELEASE: held_buttons &= ~s->buttons; break;
+            case CMD_TAP:
+                held_buttons |= s->buttons;
+                tap_release |= s->buttons;
+                break;
+            case CMD_DUMP:    dump_scanout(s->path); break;
+            case CMD_SUSPEND: start_suspend(s->duration_ns); break;
+            case CMD_EXIT:
+                print_report();
+                exit(final_status(0));
+        }
+    }
+    ctrl_ring[ctrl_samples % CTRL_BUFFERS].buttons = held_buttons;
+    ctrl_ring[ctrl_samples % CTRL_BUFFERS].time_us = sample_time_us;
+    ctrl_samples++;
+
+    if (max_vblanks && vcount >= max_vblanks) {
+        fprintf(stderr, "shim: stopping after %llu vblanks\n", (unsigned long long)vcount);
+        print_report();
+        exit(2);
+    }
+}
+
+// Process every vblank boundary the virtual clock has passed
+static void catch_up_vblanks(void) {
+    uint64_t due = virtual_ns() / VBLANK_PERIOD_NS;
+    while (vcount < due) on_vblank();
+}
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *param, SceDisplaySetBufSync sync) {
+    catch_up_vblanks();
+    if (!param) {
+        memset(&scanout, 0, sizeof(scanout));
+        pending_valid = 0;
+        return 0;
+    }
+    if (param->pitch < param->width || !param->base) return SCE_KERNEL_ERROR_ERROR;
+
+    if (sync == SCE_DISPLAY_SETBUF_IMMEDIATE) {
+        scanout = *param;
+        if (!flipped_since_vblank) record_flip();
+        flipped_since_vblank = 1;
+    } else {
+        pending = *param;
+        pending_valid = 1;
+    }
+    return 0;
+}
+
+int sceDisplayWaitVblankStartMulti(unsigned int count) {
+    catch_up_vblanks();
+    uint64_t target = vcount + (count ? count : 1);
+    uint64_t now = virtual_ns();
+    uint64_t target_ns = target * VBLANK_PERIOD_NS;
+    if (target_ns > now) advance_ns(target_ns - now);
+    catch_up_vblanks();
+    return 0;
+}
+
+int sceDisplayWaitVblankStart(void) {
+    return sceDisplayWaitVblankStartMulti(1);
+}
+
+int sceDisplayGetVcount(void) {
+    catch_up_vblanks();
+    return (int)(vcount & 0xFFFF);
+}
+
+int sceDisplayGetRefreshRate(float *fps) {
+    *fps = 59.94f;
+    return 0;
+}
+
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *data, int count) {
+    (void)port;
+    catch_up_vblanks();
+    // Latest samples, oldest first
+    if (count > CTRL_BUFFERS) count = CTRL_BUFFERS;
+    if ((uint64_t)count > ctrl_samples) count = ctrl_samples ? (int)ctrl_samples : 1;
+    for (int i = 0; i < count; i++) {
+        memset(&data[i], 0, sizeof(data[i]));
+        if (ctrl_samples) {
+            uint64_t n = ctrl_samples - count + i;
+            data[i].timeStamp = ctrl_ring[n % CTRL_BUFFERS].time_us;
+            data[i].buttons = ctrl_ring[n % CTRL_BUFFERS].buttons;
+        } else {
+            data[i].timeStamp = sample_time_us;
+            data[i].buttons = held_buttons;
+        }
+        data[i].lx = data[i].ly = data[i].rx = data[i].ry = 128;
+    }
+    return count;
+}
+
+// ============================================
+// Process and memory
+// ============================================
+
+int sceKernelExitProcess(int res) {
+    print_report();
+    exit(final_status(res));
+}
+
+int sceKernelPowerTick(SceKernelPowerTickType type) {
+    (void)type;
+    return 0;
+}
+
+// Every host run is the same console
+int sceKernelGetOpenPsId(SceKernelOpenPsId *id) {
+    static const char host_id[16] = "vita-shim-host";
+    memcpy(id->id, host_id, sizeof(id->id));
+    return 0;
+}
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size,
+                              SceKernelAllocMemBlockOpt *opt) {
+    (void)name;
+    (void)opt;
+    SceSize align = (type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW) ? 256 * 1024 : 4096;
+    if (size == 0 || size % align != 0) return SCE_KERNEL_ERROR_ERROR;
+
+    void *base = aligned_alloc(align, size);
+    if (!base) return SCE_KERNEL_ERROR_NO_MEMORY;
+    // Real memory blocks are not cleared either; make stale contents visible
+    memset(base, 0xCD, size);
+
+    SceUID uid = new_object(OBJ_MEMBLOCK, base);
+    if (uid < 0) free(base);
+    return uid;
+}
+
+int sceKernelFreeMemBlock(SceUID uid) {
+    ShimObject *obj = get_object(uid, OBJ_MEMBLOCK);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    free(obj->data);
+    free_object(uid);
+    return 0;
+}
+
+int sceKernelGetMemBlockBase(SceUID uid, void **base) {
+    ShimObject *obj = get_object(uid, OBJ_MEMBLOCK);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    *base = obj->data;
+    return 0;
+}
+
+// ============================================
+// Threads and semaphores
+// ============================================
+
+static void *thread_trampoline(void *arg) {
+    ShimThread *t = (ShimThread *)arg;
+    t->exit_status = t->entry(t->arglen, t->args);
+    return NULL;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int priority,
+                             SceSize stack_size, SceUInt attr, int affinity,
+                             const SceKernelThreadOptParam *option) {
+    (void)name; (void)priority; (void)stack_size; (void)attr; (void)affinity; (void)option;
+    ShimThread *t = calloc(1, sizeof(ShimThread));
+    if (!t) return SCE_KERNEL_ERROR_NO_MEMORY;
+    t->entry = entry;
+    SceUID uid = new_object(OBJ_THREAD, t);
+    if (uid < 0) free(t);
+    return uid;
+}
+
+int sceKernelStartThread(SceUID uid, SceSize arglen, void *argp) {
+    ShimObject *obj = get_object(uid, OBJ_THREAD);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimThread *t = (ShimThread *)obj->data;
+
+    // Like the real kernel, arguments are copied to the new thread
+    if (arglen > 0 && argp) {
+        t->args = malloc(arglen);
+        memcpy(t->args, argp, arglen);
+    }
+    t->arglen = arglen;
+    if (pthread_create(&t->handle, NULL, thread_trampoline, t) != 0) return SCE_KERNEL_ERROR_ERROR;
+    t->started = 1;
+    return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID uid, int *stat, SceUInt *timeout) {
+    (void)timeout;
+    ShimObject *obj = get_object(uid, OBJ_THREAD);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimThread *t = (ShimThread *)obj->data;
+    if (t->started) {
+        pthread_join(t->handle, NULL);
+        t->started = 0;
+    }
+    if (stat) *stat = t->exit_status;
+    return 0;
+}
+
+int sceKernelDeleteThread(SceUID uid) {
+    ShimObject *obj = get_object(uid, OBJ_THREAD);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimThread *t = (ShimThread *)obj->data;
+    if (t->started) pthread_detach(t->handle);
+    free(t->args);
+    free(t);
+    free_object(uid);
+    return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay) {
+    advance_ns((uint64_t)delay * 1000);
+    return 0;
+}
+
+// ============================================
+// Callbacks and power
+// ============================================
+
+static pthread_mutex_t callback_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t callback_cond = PTHREAD_COND_INITIALIZER;
+static SceUID power_callbacks[MAX_POWER_CALLBACKS];
+
+SceUID sceKernelCreateCallback(const char *name, unsigned int attr, SceKernelCallbackFunction func,
+                               void *arg) {
+    (void)name; (void)attr;
+    ShimCallback *cb = calloc(1, sizeof(ShimCallback));
+    if (!cb) return SCE_KERNEL_ERROR_NO_MEMORY;
+    cb->func = func;
+    cb->arg = arg;
+    cb->owner = pthread_self();
+    SceUID uid = new_object(OBJ_CALLBACK, cb);
+    if (uid < 0) free(cb);
+    return uid;
+}
+
+int sceKernelDeleteCallback(SceUID uid) {
+    ShimObject *obj = get_object(uid, OBJ_CALLBACK);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    scePowerUnregisterCallback(uid);
+    pthread_mutex_lock(&callback_lock);
+    free(obj->data);
+    free_object(uid);
+    pthread_mutex_unlock(&callback_lock);
+    return 0;
+}
+
+// Run the calling thread's notified callbacks; caller holds callback_lock
+static void run_callbacks(void) {
+    for (int i = 1; i < MAX_OBJECTS; i++) {
+        if (objects[i].kind != OBJ_CALLBACK) continue;
+        ShimCallback *cb = (ShimCallback *)objects[i].data;
+        if (cb->notify_count == 0 || !pthread_equal(cb->owner, pthread_self())) continue;
+
+        int count = cb->notify_count;
+        int arg = cb->notify_arg;
+        cb->notify_count = 0;
+        cb->notify_arg = 0;
+        pthread_mutex_unlock(&callback_lock);
+        cb->func(0x100 + i, count, arg, cb->arg);
+        pthread_mutex_lock(&callback_lock);
+    }
+}
+
+int sceKernelSleepThreadCB(void) {
+    // Nothing wakes the thread up, so it only ever runs callbacks
+    pthread_mutex_lock(&callback_lock);
+    for (;;) {
+        run_callbacks();
+        pthread_cond_wait(&callback_cond, &callback_lock);
+    }
+}
+
+int sceKernelDelayThreadCB(SceUInt delay) {
+    if (!realtime_mode && pthread_equal(pthread_self(), main_thread)) {
+        pthread_mutex_lock(&callback_lock);
+        run_callbacks();
+        pthread_mutex_unlock(&callback_lock);
+        advance_ns((uint64_t)delay * 1000);
+        return 0;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    uint64_t ns = deadline.tv_nsec + (uint64_t)delay * 1000;
+    deadline.tv_sec += ns / 1000000000ULL;
+    deadline.tv_nsec = ns % 1000000000ULL;
+
+    pthread_mutex_lock(&callback_lock);
+    do {
+        run_callbacks();
+    } while (pthread_cond_timedwait(&callback_cond, &callback_lock, &deadline) != ETIMEDOUT);
+    run_callbacks();
+    pthread_mutex_unlock(&callback_lock);
+    return 0;
+}
+
+int scePowerRegisterCallback(SceUID uid) {
+    if (!get_object(uid, OBJ_CALLBACK)) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    pthread_mutex_lock(&callback_lock);
+    for (int i = 0; i < MAX_POWER_CALLBACKS; i++) {
+        if (power_callbacks[i] == 0) {
+            power_callbacks[i] = uid;
+            pthread_mutex_unlock(&callback_lock);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&callback_lock);
+    return SCE_KERNEL_ERROR_NO_MEMORY;
+}
+
+int scePowerUnregisterCallback(SceUID uid) {
+    pthread_mutex_lock(&callback_lock);
+    for (int i = 0; i < MAX_POWER_CALLBACKS; i++) {
+        if (power_callbacks[i] == uid) power_callbacks[i] = 0;
+    }
+    pthread_mutex_unlock(&callback_lock);
+    return 0;
+}
+
+static void notify_power(int arg) {
+    pthread_mutex_lock(&callback_lock);
+    for (int i = 0; i < MAX_POWER_CALLBACKS; i++) {
+        ShimObject *obj = get_object(power_callbacks[i], OBJ_CALLBACK);
+        if (!obj) continue;
+        ShimCallback *cb = (ShimCallback *)obj->data;
+        cb->notify_count++;
+        cb->notify_arg |= arg;
+    }
+    pthread_cond_broadcast(&callback_cond);
+    pthread_mutex_unlock(&callback_lock);
+}
+
+// Like the hardware, tell the apps, give them a moment, then sleep. The
+// process is not frozen here; the clock just jumps over the sleep.
+static void *suspend_thread(void *arg) {
+    uint64_t duration_ns = *(uint64_t *)arg;
+    free(arg);
+
+    notify_power(SCE_POWER_CB_SUSPENDING);
+    struct timespec grace = {0, (long)SUSPEND_GRACE_NS};
+    nanosleep(&grace, NULL);
+
+    pthread_mutex_lock(&clock_lock);
+    skipped_ns += duration_ns;
+    pthread_mutex_unlock(&clock_lock);
+    fprintf(stderr, "shim: system suspended for %.2f s\n", duration_ns / 1e9);
+
+    notify_power(SCE_POWER_CB_RESUMING);
+    notify_power(SCE_POWER_CB_RESUME_COMPLETE);
+    return NULL;
+}
+
+static void start_suspend(uint64_t duration_ns) {
+    pthread_t thread;
+    uint64_t *arg = malloc(sizeof(*arg));
+    if (!arg) return;
+    *arg = duration_ns;
+    if (pthread_create(&thread, NULL, suspend_thread, arg) != 0) {
+        free(arg);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int init, int max,
+                           SceKernelSemaOptParam *option) {
+    (void)name; (void)attr; (void)option;
+    ShimSema *s = calloc(1, sizeof(ShimSema));
+    if (!s) return SCE_KERNEL_ERROR_NO_MEMORY;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = init;
+    s->max = max;
+    SceUID uid = new_object(OBJ_SEMA, s);
+    if (uid < 0) free(s);
+    return uid;
+}
+
+int sceKernelDeleteSema(SceUID uid) {
+    ShimObject *obj = get_object(uid, OBJ_SEMA);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    free(obj->data);
+    free_object(uid);
+    return 0;
+}
+
+int sceKernelSignalSema(SceUID uid, int signal) {
+    ShimObject *obj = get_object(uid, OBJ_SEMA);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimSema *s = (ShimSema *)obj->data;
+    pthread_mutex_lock(&s->lock);
+    s->count += signal;
+    if (s->count > s->max) s->count = s->max;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+int sceKernelWaitSema(SceUID uid, int signal, SceUInt *timeout) {
+    ShimObject *obj = get_object(uid, OBJ_SEMA);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimSema *s = (ShimSema *)obj->data;
+    int result = 0;
+
+    struct timespec deadline;
+    if (timeout) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t ns = deadline.tv_nsec + (uint64_t)*timeout * 1000;
+        deadline.tv_sec += ns / 1000000000ULL;
+        deadline.tv_nsec = ns % 1000000000ULL;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->count < signal) {
+        if (timeout) {
+            if (pthread_cond_timedwait(&s->cond, &s->lock, &deadline) == ETIMEDOUT) {
+                result = SCE_KERNEL_ERROR_WAIT_TIMEOUT;
+                break;
+            }
+        } else {
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+    }
+    if (result == 0) s->count -= signal;
+    pthread_mutex_unlock(&s->lock);
+    return result;
+}
+
+int sceKernelPollSema(SceUID uid, int signal) {
+    ShimObject *obj = get_object(uid, OBJ_SEMA);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ShimSema *s = (ShimSema *)obj->data;
+    int result = SCE_KERNEL_ERROR_SEMA_ZERO;
+    pthread_mutex_lock(&s->lock);
+    if (s->count >= signal) {
+        s->count -= signal;
+        result = 0;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return result;
+}
+
+// ============================================
+// File I/O (ux0: maps to VITA_SHIM_ROOT/ux0)
+// ============================================
+
+static char fs_root[256] = "vita_fs";
+
+static void host_path(char *out, size_t size, const char *path) {
+    const char *colon = strchr(path, ':');
+    if (colon) {
+        const char *rest = colon + 1;
+        if (*rest == '/') rest++;
+        snprintf(out, size, "%s/%.*s/%s", fs_root, (int)(colon - path), path, rest);
+    } else {
+        snprintf(out, size, "%s", path);
+    }
+}
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode) {
+    char path[512];
+    host_path(path, sizeof(path), file);
+
+    int host_flags = 0;
+    switch (flags & SCE_O_RDWR) {
+        case SCE_O_RDONLY: host_flags = O_RDONLY; break;
+        case SCE_O_WRONLY: host_flags = O_WRONLY; break;
+        default:           host_flags = O_RDWR; break;
+    }
+    if (flags & SCE_O_APPEND) host_flags |= O_APPEND;
+    if (flags & SCE_O_CREAT) host_flags |= O_CREAT;
+    if (flags & SCE_O_TRUNC) host_flags |= O_TRUNC;
+
+    int fd = open(path, host_flags, mode);
+    if (fd < 0) return SCE_KERNEL_ERROR_ERROR;
+    SceUID uid = new_object(OBJ_FILE, NULL);
+    if (uid < 0) {
+        close(fd);
+        return uid;
+    }
+    get_object(uid, OBJ_FILE)->fd = fd;
+    return uid;
+}
+
+int sceIoClose(SceUID uid) {
+    ShimObject *obj = get_object(uid, OBJ_FILE);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    close(obj->fd);
+    free_object(uid);
+    return 0;
+}
+
+int sceIoRead(SceUID uid, void *data, SceSize size) {
+    ShimObject *obj = get_object(uid, OBJ_FILE);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ssize_t n = read(obj->fd, data, size);
+    return n < 0 ? (int)SCE_KERNEL_ERROR_ERROR : (int)n;
+}
+
+int sceIoWrite(SceUID uid, const void *data, SceSize size) {
+    ShimObject *obj = get_object(uid, OBJ_FILE);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ssize_t n = write(obj->fd, data, size);
+    return n < 0 ? (int)SCE_KERNEL_ERROR_ERROR : (int)n;
+}
+
+int sceIoPread(SceUID uid, void *data, SceSize size, SceOff offset) {
+    ShimObject *obj = get_object(uid, OBJ_FILE);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    ssize_t n = pread(obj->fd, data, size, offset);
+    return n < 0 ? (int)SCE_KERNEL_ERROR_ERROR : (int)n;
+}
+
+SceOff sceIoLseek(SceUID uid, SceOff offset, int whence) {
+    ShimObject *obj = get_object(uid, OBJ_FILE);
+    if (!obj) return SCE_KERNEL_ERROR_ILLEGAL_UID;
+    int host_whence = whence == SCE_SEEK_CUR ? SEEK_CUR : whence == SCE_SEEK_END ? SEEK_END : SEEK_SET;
+    off_t pos = lseek(obj->fd, offset, host_whence);
+    return pos < 0 ? (SceOff)(int)SCE_KERNEL_ERROR_ERROR : (SceOff)pos;
+}
+
+int sceIoRemove(const char *file) {
+    char path[512];
+    host_path(path, sizeof(path), file);
+    return unlink(path) == 0 ? 0 : (int)SCE_KERNEL_ERROR_ERROR;
+}
+
+int sceIoRename(const char *oldname, const char *newname) {
+    char from[512], to[512];
+    host_path(from, sizeof(from), oldname);
+    host_path(to, sizeof(to), newname);
+    return rename(from, to) == 0 ? 0 : (int)SCE_KERNEL_ERROR_ERROR;
+}
+
+int sceIoMkdir(const char *dir, SceMode mode) {
+    char path[512];
+    host_path(path, sizeof(path), dir);
+
+    // Create intermediate directories on the host side (e.g. vita_fs/ux0)
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0777);
+            *p = '/';
+        }
+    }
+    return mkdir(path, mode) == 0 ? 0 : (int)SCE_KERNEL_ERROR_ERROR;
+}
+
+// ============================================
+// Setup
+// ============================================
+
+__attribute__((constructor))
+static void shim_init(void) {
+    main_thread = pthread_self();
+    start_ns = real_ns();
+
+    const char *mode = getenv("VITA_SHIM_MODE");
+    realtime_mode = (mode && strcmp(mode, "realtime") == 0);
+
+    const char *root = getenv("VITA_SHIM_ROOT");
+    if (root) snprintf(fs_root, sizeof(fs_root), "%s", root);
+
+    const char *limit = getenv("VITA_SHIM_MAX_VBLANKS");
+    if (limit) max_vblanks = strtoull(limit, NULL, 10);
+
+    const char *late = getenv("VITA_SHIM_MAX_LATE");
+    if (late) max_late_percent = atoi(late);
+
+    const char *path = getenv("VITA_SHIM_SCRIPT");
+    if (path) load_script(path);
+}
@@ -0,0 +1,355 @@
+#include "apl.h"
+#include "color.h"
+#include "evlog.h"
+#include "span.h"
+
+#include <psp2/kernel/processmgr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCREEN_PIXELS ((uint64_t)SCREEN_WIDTH * SCREEN_HEIGHT)
+
+// Totals of rasterized pattern states, for patterns without a cheaper path
+#define FULL_CACHE_SIZE 16
+
+#define NO_SEGMENT   -2
+#define VIEW_SEGMENT -1
+
+typedef enum {
+    SOURCE_SOLID,     // One color everywhere
+    SOURCE_ROW,       // All rows equal `profile`
+    SOURCE_COLUMN,    // All columns equal `profile`
+    SOURCE_FULL       // Closed form or rasterized
+} TotalsSource;
+
+typedef struct {
+    int valid;
+    int pattern;
+    PatternArgs args;
+    int state;
+    uint64_t totals[3];
+} PatternTotals;
+
+// The pattern state shown in the current frame
+static PatternTotals current;
+static TotalsSource current_source;
+static uint32_t current_color;
+static uint32_t prefix[SCREEN_WIDTH + 1][3];   // Running sums along the row/column profile
+static uint32_t profile_row[SCREEN_FB_WIDTH];
+
+// Filled by apl_prewarm() before startup is ready, read-only afterwards
+static PatternTotals static_totals[PATTERN_MAX_COUNT];
+
+static PatternTotals full_cache[FULL_CACHE_SIZE];
+static int full_cache_next = 0;
+static uint32_t *scratch = NULL;
+
+static int64_t frame_totals[3];
+static uint32_t frame_cost = 0;
+static int frame_segment = NO_SEGMENT;
+static AplFrame last;
+
+static int segment = NO_SEGMENT;
+static uint32_t segment_frames = 0;
+static uint64_t segment_apl = 0;
+static uint64_t segment_means[3];
+static uint32_t segment_min = 0;
+static uint32_t segment_max = 0;
+
+static uint32_t session_frames = 0;
+static uint32_t session_rendered = 0;   // session_frames less the held ones
+static uint64_t session_apl = 0;
+static uint64_t session_cost = 0;
+static uint32_t session_max_cost = 0;
+
+static const Rect full_screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+static uint32_t *get_scratch(void) {
+    if (!scratch) scratch = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    return scratch;
+}
+
+static void build_prefix(const uint32_t *profile, int count, int stride) {
+    prefix[0][0] = prefix[0][1] = prefix[0][2] = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t p = profile[i * stride];
+        prefix[i + 1][0] = prefix[i][0] + (p & 0xFF);
+        prefix[i + 1][1] = prefix[i][1] + ((p >> 8) & 0xFF);
+        prefix[i + 1][2] = prefix[i][2] + ((p >> 16) & 0xFF);
+    }
+}
+
+// Reduce r of a buffer with SCREEN_FB_WIDTH pitch
+static void sum_rect(const uint32_t *pixels, const Rect *r, uint64_t totals[3]) {
+    for (int y = r->y0; y < r->y1; y++) {
+        uint32_t sums[3] = {0, 0, 0};
+        sum_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, sums);
+        totals[0] += sums[0];
+        totals[1] += sums[1];
+        totals[2] += sums[2];
+    }
+}
+
+static int same_state(const PatternTotals *a, const PatternTotals *b) {
+    return a->valid && a->pattern == b->pattern && a->state == b->state &&
+           memcmp(&a->args, &b->args, sizeof(a->args)) == 0;
+}
+
+static int full_totals(const PatternDesc *desc, PatternTotals *t) {
+    if (desc->totals) {
+        desc->totals(&t->args, t->state, t->totals);
+        return 0;
+    }
+
+    if (same_state(&static_totals[t->pattern], t)) {
+        memcpy(t->totals, static_totals[t->pattern].totals, sizeof(t->totals));
+        return 0;
+    }
+
+    for (int i = 0; i < FULL_CACHE_SIZE; i++) {
+        const PatternTotals *c = &full_cache[i];
+        if (same_state(c, t)) {
+            memcpy(t->totals, c->totals, sizeof(t->totals));
+            return 0;
+        }
+    }
+
+    uint32_t *buffer = get_scratch();
+    if (!buffer) return -1;
+    pattern_render(buffer, &full_screen, desc, &t->args, t->state);
+    t->totals[0] = t->totals[1] = t->totals[2] = 0;
+    sum_rect(buffer, &full_screen, t->totals);
+
+    full_cache[full_cache_next] = *t;
+    full_cache_next = (full_cache_next + 1) % FULL_CACHE_SIZE;
+    return 0;
+}
+
+static void compute_totals(const PatternDesc *desc) {
+    PatternTotals *t = &current;
+
+    if (desc->flags & PATTERN_SOLID) {
+        current_source = SOURCE_SOLID;
+        current_color = desc->solid_color(&t->args, t->state);
+        t->totals[0] = (current_color & 0xFF) * SCREEN_PIXELS;
+        t->totals[1] = ((current_color >> 8) & 0xFF) * SCREEN_PIXELS;
+        t->totals[2] = ((current_color >> 16) & 0xFF) * SCREEN_PIXELS;
+    } else if (desc->flags & PATTERN_ROWS_SAME) {
+        Rect row = {0, 0, SCREEN_WIDTH, 1};
+        current_source = SOURCE_ROW;
+        pattern_render(profile_row, &row, desc, &t->args, t->state);
+        build_prefix(profile_row, SCREEN_WIDTH, 1);
+        for (int c = 0; c < 3; c++) {
+            t->totals[c] = (uint64_t)prefix[SCREEN_WIDTH][c] * SCREEN_HEIGHT;
+        }
+    } else if ((desc->flags & PATTERN_COLUMNS_SAME) && get_scratch()) {
+        Rect column = {0, 0, 1, SCREEN_HEIGHT};
+        current_source = SOURCE_COLUMN;
+        pattern_render(scratch, &column, desc, &t->args, t->state);
+        build_prefix(scratch, SCREEN_HEIGHT, SCREEN_FB_WIDTH);
+        for (int c = 0; c < 3; c++) {
+            t->totals[c] = (uint64_t)prefix[SCREEN_HEIGHT][c] * SCREEN_WIDTH;
+        }
+    } else {
+        current_source = SOURCE_FULL;
+        if (full_totals(desc, t) < 0) {
+            t->totals[0] = t->totals[1] = t->totals[2] = 0;
+        }
+    }
+    t->valid = 1;
+}
+
+// Totals of the current pattern state inside r
+static void pattern_rect_totals(const Rect *r, uint64_t totals[3]) {
+    uint64_t w = r->x1 - r->x0;
+    uint64_t h = r->y1 - r->y0;
+
+    switch (current_source) {
+        case SOURCE_SOLID:
+            totals[0] = (current_color & 0xFF) * w * h;
+            totals[1] = ((current_color >> 8) & 0xFF) * w * h;
+            totals[2] = ((current_color >> 16) & 0xFF) * w * h;
+            break;
+        case SOURCE_ROW:
+            for (int c = 0; c < 3; c++) {
+                totals[c] = (uint64_t)(prefix[r->x1][c] - prefix[r->x0][c]) * h;
+            }
+            break;
+        case SOURCE_COLUMN:
+            for (int c = 0; c < 3; c++) {
+                totals[c] = (uint64_t)(prefix[r->y1][c] - prefix[r->y0][c]) * w;
+            }
+            break;
+        default:
+            totals[0] = totals[1] = totals[2] = 0;
+            if (get_scratch()) {
+                pattern_render(scratch, r, pattern_get(current.pattern), &current.args, current.state);
+                sum_rect(scratch, r, totals);
+            } else {
+                // Assume the area averages like the whole screen
+                for (int c = 0; c < 3; c++) {
+                    totals[c] = current.totals[c] * w * h / SCREEN_PIXELS;
+                }
+            }
+            break;
+    }
+}
+
+void apl_prewarm(void) {
+    uint32_t *buffer = get_scratch();
+    if (!buffer) return;
+
+    for (int p = 0; p < pattern_count(); p++) {
+        const PatternDesc *desc = pattern_get(p);
+        PatternTotals *t = &static_totals[p];
+        if (desc->flags & (PATTERN_ANIMATED | PATTERN_SOLID | PATTERN_ROWS_SAME | PATTERN_COLUMNS_SAME)) continue;
+        if (desc->totals) continue;
+
+        t->pattern = p;
+        t->state = 0;
+        pattern_default_args(desc, &t->args);
+        pattern_render(buffer, &full_screen, desc, &t->args, 0);
+        t->totals[0] = t->totals[1] = t->totals[2] = 0;
+        sum_rect(buffer, &full_screen, t->totals);
+        t->valid = 1;
+    }
+}
+
+static uint32_t elapsed_since(uint64_t start) {
+    return (uint32_t)(sceKernelGetProcessTimeWide() - start);
+}
+
+void apl_begin_pattern(int pattern, const PatternArgs *args, int state) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+
+    PatternTotals shown = {.valid = 1, .pattern = pattern, .args = *args, .state = state};
+    if (!same_state(&current, &shown)) {
+        current = shown;
+        compute_totals(pattern_get(pattern));
+    }
+
+    for (int c = 0; c < 3; c++) {
+        frame_totals[c] = (int64_t)current.totals[c];
+    }
+    frame_segment = pattern;
+    frame_cost = elapsed_since(start);
+}
+
+void apl_begin_view(const uint32_t *pixels) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+    uint64_t totals[3] = {0, 0, 0};
+    sum_rect(pixels, &full_screen, totals);
+    for (int c = 0; c < 3; c++) {
+        frame_totals[c] = (int64_t)totals[c];
+    }
+    current.valid = 0;
+    frame_segment = VIEW_SEGMENT;
+    frame_cost = elapsed_since(start);
+}
+
+void apl_overlay(const uint32_t *pixels, const Rect *r) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+    Rect clip = *r;
+    if (clip.x0 < 0) clip.x0 = 0;
+    if (clip.y0 < 0) clip.y0 = 0;
+    if (clip.x1 > SCREEN_WIDTH) clip.x1 = SCREEN_WIDTH;
+    if (clip.y1 > SCREEN_HEIGHT) clip.y1 = SCREEN_HEIGHT;
+    if (clip.x0 >= clip.x1 || clip.y0 >= clip.y1) return;
+
+    // Swap the pattern's share of the area for what is actually there
+    uint64_t shown[3] = {0, 0, 0};
+    sum_rect(pixels, &clip, shown);
+    if (frame_segment != VIEW_SEGMENT) {
+        uint64_t covered[3];
+        pattern_rect_totals(&clip, covered);
+        for (int c = 0; c < 3; c++) {
+            frame_totals[c] += (int64_t)shown[c] - (int64_t)covered[c];
+        }
+    }
+    frame_cost += elapsed_since(start);
+}
+
+static const char *segment_name(int seg) {
+    if (seg == VIEW_SEGMENT) return "view";
+    return pattern_get(seg)->name;
+}
+
+static void end_segment(void) {
+    if (segment == NO_SEGMENT || segment_frames == 0) return;
+    uint32_t avg = (uint32_t)(segment_apl / segment_frames);
+    uint32_t r = (uint32_t)(segment_means[0] / segment_frames);
+    uint32_t g = (uint32_t)(segment_means[1] / segment_frames);
+    uint32_t b = (uint32_t)(segment_means[2] / segment_frames);
+    evlog_printf("apl: '%s' %u frames avg %u.%02u%% min %u.%02u%% max %u.%02u%% "
+                 "R %u.%02u G %u.%02u B %u.%02u",
+                 segment_name(segment), (unsigned)segment_frames,
+                 (unsigned)(avg / 100), (unsigned)(avg % 100),
+                 (unsigned)(segment_min / 100), (unsigned)(segment_min % 100),
+                 (unsigned)(segment_max / 100), (unsigned)(segment_max % 100),
+                 (unsigned)(r / 100), (unsigned)(r % 100), (unsigned)(g / 100), (unsigned)(g % 100),
+                 (unsigned)(b / 100), (unsigned)(b % 100));
+    segment_frames = 0;
+}
+
+// Add the last frame's figures to its segment and the session
+static void count_frame(void) {
+    if (frame_segment != segment) {
+        end_segment();
+        segment = frame_segment;
+        segment_apl = 0;
+        segment_means[0] = segment_means[1] = segment_means[2] = 0;
+        segment_min = 0xFFFFFFFF;
+        segment_max = 0;
+    }
+    segment_frames++;
+    segment_apl += last.apl_x100;
+    for (int c = 0; c < 3; c++) {
+        segment_means[c] += last.mean_x100[c];
+    }
+    if (last.apl_x100 < segment_min) segment_min = last.apl_x100;
+    if (last.apl_x100 > segment_max) segment_max = last.apl_x100;
+    session_frames++;
+    session_apl += last.apl_x100;
+}
+
+const AplFrame *apl_end_frame(void) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+    int64_t t[3];
+    for (int c = 0; c < 3; c++) {
+        t[c] = frame_totals[c] > 0 ? frame_totals[c] : 0;
+        last.mean_x100[c] = (uint32_t)((uint64_t)t[c] * 100 / SCREEN_PIXELS);
+    }
+    uint64_t luma = COLOR_LUMA709_R * (uint64_t)t[0] + COLOR_LUMA709_G * (uint64_t)t[1] +
+                    COLOR_LUMA709_B * (uint64_t)t[2];
+    last.apl_x100 = (uint32_t)(luma / (255 * SCREEN_PIXELS));
+
+    count_frame();
+
+    last.cost_us = frame_cost + elapsed_since(start);
+    session_rendered++;
+    session_cost += last.cost_us;
+    if (last.cost_us > session_max_cost) session_max_cost = last.cost_us;
+    return &last;
+}
+
+void apl_hold_frame(void) {
+    if (segment == NO_SEGMENT) return;
+    count_frame();
+}
+
+const AplFrame *apl_last(void) {
+    return &last;
+}
+
+void apl_term(void) {
+    end_segment();
+    segment = NO_SEGMENT;
+    if (session_frames > 0) {
+        uint32_t avg = (uint32_t)(session_apl / session_frames);
+        evlog_printf("apl: session %u frames avg %u.%02u%%, cost avg %u us max %u us",
+                     (unsigned)session_frames, (unsigned)(avg / 100), (unsigned)(avg % 100),
+                     (unsigned)(session_cost / (session_rendered ? session_rendered : 1)), (unsigned)session_max_cost);
+    }
+    free(scratch);
+    scratch = NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef APL_H
+#define APL_H
+
+#include <stdint.h>
+#include "display.h"
+#include "patterns.h"
+
+// Average picture level.
+//
+// Per-channel means and the APL (Rec. 709 luma as a percentage of full
+// white) of every displayed frame. Pattern content is accounted for
+// analytically from the registry: solid colors, a single row or column
+// profile, or a closed-form totals hook; other patterns are rasterized
+// once per state into a scratch buffer and cached. Only areas covered by
+// overlays (and non-pattern views) are reduced from the framebuffer.
+//
+// Consecutive frames of the same pattern form a segment; each segment's
+// average, minimum and maximum APL go to the event log when it ends.
+
+typedef struct {
+    uint32_t mean_x100[3];   // Per-channel mean code value x 100 (R, G, B)
+    uint32_t apl_x100;       // APL in hundredths of a percent
+    uint32_t cost_us;        // Time spent on this frame's figures
+} AplFrame;
+
+// Startup task: rasterize static patterns that have no cheaper path once
+void apl_prewarm(void);
+
+// Start a frame showing a registry pattern state
+void apl_begin_pattern(int pattern, const PatternArgs *args, int state);
+
+// Start a frame that is not a pattern; the whole framebuffer is reduced
+void apl_begin_view(const uint32_t *pixels);
+
+// An opaque overlay was drawn over r in pixels
+void apl_overlay(const uint32_t *pixels, const Rect *r);
+
+// Finish the frame and return its figures
+const AplFrame *apl_end_frame(void);
+
+// The last finished frame stays on screen for another frame: count it
+// again into its segment (nothing is recomputed)
+void apl_hold_frame(void);
+
+// Figures of the last finished frame
+const AplFrame *apl_last(void);
+
+// Log the open segment and the session summary
+void apl_term(void);
+
+#endif
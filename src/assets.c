@@ -0,0 +1,106 @@
+#include "assets.h"
+#include "evlog.h"
+
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/sysmem.h>
+#include <stdio.h>
+
+// Read size and memory block granularity
+#define READ_CHUNK (1024 * 1024)
+#define BLOCK_ALIGN (4 * 1024)
+
+static SceUID block = -1;
+static Pack pack;
+static int loaded = 0;
+
+// Entry last checked against its checksum; the same lookup repeats every frame
+static const PackEntry *checked_entry = NULL;
+static int checked_ok = 0;
+
+void assets_load(void) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+    SceUID fd = sceIoOpen(ASSETS_PACK_PATH, SCE_O_RDONLY, 0);
+    if (fd < 0) {
+        evlog_printf("assets: no pack");
+        return;
+    }
+
+    SceOff size = sceIoLseek(fd, 0, SCE_SEEK_END);
+    sceIoLseek(fd, 0, SCE_SEEK_SET);
+    if (size < (SceOff)sizeof(PackHeader) || size > 0x7FFFFFFF) {
+        sceIoClose(fd);
+        evlog_printf("assets: bad pack size");
+        return;
+    }
+
+    SceSize block_size = ((SceSize)size + BLOCK_ALIGN - 1) & ~(SceSize)(BLOCK_ALIGN - 1);
+    block = sceKernelAllocMemBlock("assets", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW, block_size, NULL);
+    void *base = NULL;
+    if (block < 0 || sceKernelGetMemBlockBase(block, &base) < 0) {
+        sceIoClose(fd);
+        evlog_printf("assets: no memory for %u bytes", (unsigned)size);
+        assets_term();
+        return;
+    }
+
+    uint32_t done = 0;
+    while (done < (uint32_t)size) {
+        uint32_t chunk = (uint32_t)size - done;
+        if (chunk > READ_CHUNK) chunk = READ_CHUNK;
+        int n = sceIoRead(fd, (uint8_t *)base + done, chunk);
+        if (n <= 0) break;
+        done += (uint32_t)n;
+    }
+    sceIoClose(fd);
+
+    if (done != (uint32_t)size || pack_open(&pack, base, done) < 0) {
+        evlog_printf("assets: pack is damaged");
+        assets_term();
+        return;
+    }
+    loaded = 1;
+    evlog_printf("assets: %u entries, %u bytes in %u us", (unsigned)pack.count, (unsigned)done,
+                 (unsigned)(sceKernelGetProcessTimeWide() - start));
+}
+
+void assets_term(void) {
+    loaded = 0;
+    checked_entry = NULL;
+    if (block >= 0) sceKernelFreeMemBlock(block);
+    block = -1;
+}
+
+const Pack *assets_pack(void) {
+    return loaded ? &pack : NULL;
+}
+
+// Whether the stored bytes of entry still match its checksum
+static int entry_intact(const PackEntry *entry) {
+    if (entry != checked_entry) {
+        checked_entry = entry;
+        checked_ok = pack_checksum(pack_data(&pack, entry), entry->size) == entry->checksum;
+        if (!checked_ok) evlog_printf("assets: '%s' is damaged", entry->name);
+    }
+    return checked_ok;
+}
+
+const char *assets_text(const char *name) {
+    if (!loaded) return NULL;
+    const PackEntry *entry = pack_find(&pack, name);
+    if (!entry || entry->encoding != PACK_DATA || !entry_intact(entry)) return NULL;
+    return (const char *)pack_data(&pack, entry);
+}
+
+const char *assets_pattern_hint(const char *pattern_name) {
+    char name[PACK_NAME_SIZE];
+    int len = snprintf(name, sizeof(name), "hints/");
+    for (const char *p = pattern_name; *p && len < (int)sizeof(name) - 5; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))) c = '_';
+        name[len++] = c;
+    }
+    snprintf(name + len, sizeof(name) - len, ".txt");
+    return assets_text(name);
+}
@@ -0,0 +1,32 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "pack.h"
+
+// Application assets.
+//
+// The asset pack (ASSETS_PACK_PATH, shipped in the vpk) is read once at
+// startup with large sequential reads into a memory block and then used in
+// place: lookups return pointers into that block. Everything is optional,
+// a missing or malformed pack only means no assets, and an entry that no
+// longer matches its checksum is not returned.
+
+#define ASSETS_PACK_PATH "app0:assets.pack"
+
+// Startup task: load the pack
+void assets_load(void);
+
+// Free the memory block
+void assets_term(void);
+
+// The loaded pack, or NULL
+const Pack *assets_pack(void);
+
+// NUL-terminated contents of an intact PACK_DATA entry, or NULL
+const char *assets_text(const char *name);
+
+// Hint text for a registry pattern ("hints/<name>.txt" with the name in
+// lower case and anything but letters and digits replaced by '_'), or NULL
+const char *assets_pattern_hint(const char *pattern_name);
+
+#endif
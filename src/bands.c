@@ -0,0 +1,95 @@
+#include "bands.h"
+#include "evlog.h"
+
+#include <psp2/kernel/threadmgr.h>
+
+typedef struct {
+    uint32_t *pixels;
+    Rect band;
+    const PatternDesc *desc;
+    const PatternArgs *args;
+    int state;
+} BandJob;
+
+static const int worker_cpus[BANDS_WORKERS] = {SCE_KERNEL_CPU_MASK_USER_1, SCE_KERNEL_CPU_MASK_USER_2};
+
+static BandJob jobs[BANDS_WORKERS];
+static SceUID workers[BANDS_WORKERS] = {-1, -1};
+static SceUID start_sema[BANDS_WORKERS] = {-1, -1};
+static SceUID done_sema = -1;
+static int worker_count = 0;
+static int quitting = 0;
+
+static int band_thread(SceSize args, void *argp) {
+    (void)args;
+    int index = *(const int *)argp;
+    while (1) {
+        sceKernelWaitSema(start_sema[index], 1, NULL);
+        if (__atomic_load_n(&quitting, __ATOMIC_ACQUIRE)) break;
+        const BandJob *job = &jobs[index];
+        pattern_render(job->pixels, &job->band, job->desc, job->args, job->state);
+        sceKernelSignalSema(done_sema, 1);
+    }
+    return 0;
+}
+
+int bands_init(void) {
+    done_sema = sceKernelCreateSema("bands_done", 0, 0, BANDS_WORKERS, NULL);
+    if (done_sema < 0) return -1;
+
+    // Above the exposure worker, which shares the last core
+    for (int i = 0; i < BANDS_WORKERS; i++) {
+        start_sema[i] = sceKernelCreateSema("bands_start", 0, 0, 1, NULL);
+        if (start_sema[i] < 0) break;
+        workers[i] = sceKernelCreateThread("bands", band_thread, SCE_KERNEL_DEFAULT_PRIORITY_USER,
+                                           0x4000, 0, worker_cpus[i], NULL);
+        if (workers[i] < 0) break;
+        sceKernelStartThread(workers[i], sizeof(i), &i);
+        worker_count++;
+    }
+    if (worker_count < BANDS_WORKERS) evlog_printf("bands: %d of %d workers", worker_count, BANDS_WORKERS);
+    return 0;
+}
+
+void bands_term(void) {
+    __atomic_store_n(&quitting, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < BANDS_WORKERS; i++) {
+        if (workers[i] >= 0) {
+            sceKernelSignalSema(start_sema[i], 1);
+            sceKernelWaitThreadEnd(workers[i], NULL, NULL);
+            sceKernelDeleteThread(workers[i]);
+        }
+        if (start_sema[i] >= 0) sceKernelDeleteSema(start_sema[i]);
+        workers[i] = start_sema[i] = -1;
+    }
+    if (done_sema >= 0) sceKernelDeleteSema(done_sema);
+    done_sema = -1;
+    worker_count = 0;
+}
+
+void bands_render(uint32_t *pixels, const Rect *r, const PatternDesc *desc,
+                  const PatternArgs *args, int state) {
+    int rows = r->y1 - r->y0;
+    if (worker_count == 0 || rows < BANDS_MIN_ROWS) {
+        pattern_render(pixels, r, desc, args, state);
+        return;
+    }
+
+    int bands = worker_count + 1;
+    for (int i = 0; i < worker_count; i++) {
+        BandJob *job = &jobs[i];
+        job->pixels = pixels;
+        job->band = *r;
+        job->band.y0 = r->y0 + rows * (i + 1) / bands;
+        job->band.y1 = r->y0 + rows * (i + 2) / bands;
+        job->desc = desc;
+        job->args = args;
+        job->state = state;
+        sceKernelSignalSema(start_sema[i], 1);
+    }
+
+    Rect first = *r;
+    first.y1 = r->y0 + rows / bands;
+    pattern_render(pixels, &first, desc, args, state);
+    sceKernelWaitSema(done_sema, worker_count, NULL);
+}
@@ -0,0 +1,27 @@
+#ifndef BANDS_H
+#define BANDS_H
+
+#include <stdint.h>
+#include "display.h"
+#include "patterns.h"
+
+// Parallel band rendering.
+//
+// Painters write only inside the rect they are given and keep no state,
+// so a full paint can be split into horizontal bands painted on several
+// cores at once with the same result as one pass. The main thread paints
+// the first band and a worker on each of the other user cores paints one
+// of the rest; bands_render() returns once all of them are done.
+
+#define BANDS_WORKERS  2
+#define BANDS_MIN_ROWS 64    // Fewer rows are painted inline
+
+// Start the workers; without them bands_render() paints inline
+int bands_init(void);
+void bands_term(void);
+
+// pattern_render() split across the cores
+void bands_render(uint32_t *pixels, const Rect *r, const PatternDesc *desc,
+                  const PatternArgs *args, int state);
+
+#endif
@@ -0,0 +1,344 @@
+#include "color.h"
+#include "display.h"
+
+#include <stddef.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define GAMMA_CURVES (COLOR_GAMMA_MAX - COLOR_GAMMA_MIN + 1)
+
+// linear_to_srgb is indexed by the top 12 bits of a linear value
+#define LINEAR_BITS 12
+
+static uint32_t hue_table[COLOR_HUE_STEPS];    // Full saturation and value
+static uint16_t srgb_to_linear[256];
+static uint8_t linear_to_srgb[1 << LINEAR_BITS];
+static uint8_t srgb_curve[COLOR_CURVE_SIZE];
+static uint8_t lstar_curve[COLOR_CURVE_SIZE];
+static uint8_t gamma_curves[GAMMA_CURVES][COLOR_CURVE_SIZE];
+static uint32_t wave_table[1 << COLOR_WAVE_BITS];  // Gray pixels
+
+// cos and sin of one wave table step (2 pi / 1024) in Q30
+#define WAVE_STEP_COS 1073721611
+#define WAVE_STEP_SIN 6588356
+
+// Rec. 709 Y'CbCr to R'G'B' in 16.16: R = Y + 1.5748 Cr,
+// G = Y - 0.1873 Cb - 0.4681 Cr, B = Y + 1.8556 Cb
+#define YCC_R_CR 103206
+#define YCC_G_CB 12276
+#define YCC_G_CR 30679
+#define YCC_B_CB 121609
+
+static inline int clamp_channel(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// x / 255, rounded, for x up to 255 * 255
+static inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// ============================================
+// Table building
+// ============================================
+
+// Natural log and exp for building the tables; the Vita build does not
+// link libm and nothing here runs per frame
+static double ln_d(double x) {
+    const double ln2 = 0.69314718055994530942;
+    int k = 0;
+    while (x >= 2.0) { x *= 0.5; k++; }
+    while (x < 1.0) { x *= 2.0; k--; }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)), with |z| < 1/3 on [1, 2)
+    double z = (x - 1.0) / (x + 1.0);
+    double z2 = z * z;
+    double term = z;
+    double sum = 0.0;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= z2;
+    }
+    return 2.0 * sum + k * ln2;
+}
+
+static double exp_d(double y) {
+    // exp(y) = exp(y / 1024)^1024, the series converges in a few terms
+    double x = y / 1024.0;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 12; n++) {
+        term *= x / n;
+        sum += term;
+    }
+    for (int i = 0; i < 10; i++) sum *= sum;
+    return sum;
+}
+
+static double pow_d(double x, double e) {
+    return x <= 0.0 ? 0.0 : exp_d(e * ln_d(x));
+}
+
+static double srgb_encode(double linear) {
+    return linear <= 0.0031308 ? 12.92 * linear : 1.055 * pow_d(linear, 1.0 / 2.4) - 0.055;
+}
+
+static double srgb_decode(double code) {
+    return code <= 0.04045 ? code / 12.92 : pow_d((code + 0.055) / 1.055, 2.4);
+}
+
+static uint8_t to_code(double v) {
+    if (v <= 0.0) return 0;
+    if (v >= 1.0) return 255;
+    return (uint8_t)(v * 255.0 + 0.5);
+}
+
+static uint32_t wave_pixel(int64_t sin_q30) {
+    uint32_t level = (uint32_t)(((sin_q30 + (1 << 30)) * 255 + (1 << 30)) >> 31);
+    return 0xFF000000 | (level * 0x010101);
+}
+
+// Rotate a Q30 unit vector through the first quarter period and mirror it
+// into the other three
+static void init_wave_table(void) {
+    const int quarter = 1 << (COLOR_WAVE_BITS - 2);
+    int64_t x = (int64_t)1 << 30;
+    int64_t y = 0;
+    for (int i = 0; i <= quarter; i++) {
+        wave_table[i] = wave_pixel(y);
+        wave_table[2 * quarter - i] = wave_pixel(y);
+        if (i > 0) wave_table[4 * quarter - i] = wave_pixel(-y);
+        wave_table[2 * quarter + i] = wave_pixel(-y);
+        int64_t nx = (x * WAVE_STEP_COS - y * WAVE_STEP_SIN + (1 << 29)) >> 30;
+        y = (x * WAVE_STEP_SIN + y * WAVE_STEP_COS + (1 << 29)) >> 30;
+        x = nx;
+    }
+}
+
+void color_init_tables(void) {
+    for (int h = 0; h < COLOR_HUE_STEPS; h++) {
+        hue_table[h] = color_hsv(h, 255, 255);
+    }
+
+    for (int c = 0; c < 256; c++) {
+        srgb_to_linear[c] = (uint16_t)(srgb_decode(c / 255.0) * 65535.0 + 0.5);
+    }
+    // Sample the middle of each bucket of linear values
+    for (int i = 0; i < (1 << LINEAR_BITS); i++) {
+        linear_to_srgb[i] = to_code(srgb_encode((i + 0.5) / (1 << LINEAR_BITS)));
+    }
+
+    for (int i = 0; i < COLOR_CURVE_SIZE; i++) {
+        double t = (double)i / (COLOR_CURVE_SIZE - 1);
+        srgb_curve[i] = to_code(srgb_encode(t));
+
+        // CIE L* = 100 t back to relative luminance
+        double l = 100.0 * t;
+        double y = l > 8.0 ? pow_d((l + 16.0) / 116.0, 3.0) : l / 903.2963;
+        lstar_curve[i] = to_code(srgb_encode(y));
+
+        for (int g = 0; g < GAMMA_CURVES; g++) {
+            gamma_curves[g][i] = to_code(pow_d(t, 10.0 / (COLOR_GAMMA_MIN + g)));
+        }
+    }
+
+    init_wave_table();
+}
+
+// ============================================
+// Hue
+// ============================================
+
+uint32_t color_hsv(int hue, int s, int v) {
+    hue %= COLOR_HUE_STEPS;
+    if (hue < 0) hue += COLOR_HUE_STEPS;
+    int sector = hue >> 8;
+    int f = hue & 0xFF;
+
+    int p = div255(v * (255 - s));
+    int q = div255(v * (255 - div255(s * f)));
+    int t = div255(v * (255 - div255(s * (255 - f))));
+
+    switch (sector) {
+        case 0: return make_color_bgr(v, t, p);
+        case 1: return make_color_bgr(q, v, p);
+        case 2: return make_color_bgr(p, v, t);
+        case 3: return make_color_bgr(p, q, v);
+        case 4: return make_color_bgr(t, p, v);
+        default: return make_color_bgr(v, p, q);
+    }
+}
+
+uint32_t color_hsl(int hue, int s, int l) {
+    // Same hue and chroma expressed as HSV
+    int v = l + div255(s * (l < 255 - l ? l : 255 - l));
+    int sv = v > 0 ? (2 * (v - l) * 255 + v / 2) / v : 0;
+    return color_hsv(hue, clamp_channel(sv), v);
+}
+
+void color_hue_span(uint32_t *dst, int count, int32_t hue, int32_t step) {
+    const int32_t turn = COLOR_HUE_STEPS << 16;
+    hue %= turn;
+    if (hue < 0) hue += turn;
+    while (count-- > 0) {
+        *dst++ = hue_table[hue >> 16];
+        hue += step;
+        if (hue >= turn) hue -= turn;
+    }
+}
+
+// ============================================
+// Transfer curves
+// ============================================
+
+uint16_t color_srgb_to_linear(uint8_t c) {
+    return srgb_to_linear[c];
+}
+
+uint8_t color_linear_to_srgb(uint16_t linear) {
+    return linear_to_srgb[linear >> (16 - LINEAR_BITS)];
+}
+
+const uint8_t *color_srgb_curve(void) {
+    return srgb_curve;
+}
+
+const uint8_t *color_lstar_curve(void) {
+    return lstar_curve;
+}
+
+const uint8_t *color_gamma_curve(int gamma_x10) {
+    if (gamma_x10 < COLOR_GAMMA_MIN) gamma_x10 = COLOR_GAMMA_MIN;
+    if (gamma_x10 > COLOR_GAMMA_MAX) gamma_x10 = COLOR_GAMMA_MAX;
+    return gamma_curves[gamma_x10 - COLOR_GAMMA_MIN];
+}
+
+void color_curve_span(uint32_t *dst, int count, int32_t v, int32_t step, const uint8_t *curve, uint32_t mul) {
+    while (count-- > 0) {
+        int32_t i = v >> 16;
+        if (i < 0) i = 0;
+        if (i > COLOR_CURVE_SIZE - 1) i = COLOR_CURVE_SIZE - 1;
+        *dst++ = 0xFF000000 | ((uint32_t)curve[i] * mul);
+        v += step;
+    }
+}
+
+// ============================================
+// Waves
+// ============================================
+
+void color_wave_span(uint32_t *dst, int count, uint32_t phase, uint32_t delta, uint32_t delta2) {
+    const int shift = 32 - COLOR_WAVE_BITS;
+#if defined(__ARM_NEON)
+    // Lane l holds pixel 4n + l; four steps on, its phase has moved by
+    // four first differences, 4 * (delta + l * delta2) + 6 * delta2
+    const uint32_t p4[4] = {phase, phase + delta, phase + 2 * delta + delta2, phase + 3 * delta + 3 * delta2};
+    const uint32_t d4[4] = {4 * delta + 6 * delta2, 4 * delta + 10 * delta2,
+                            4 * delta + 14 * delta2, 4 * delta + 18 * delta2};
+    uint32x4_t vp = vld1q_u32(p4);
+    uint32x4_t vd = vld1q_u32(d4);
+    uint32x4_t vdd = vdupq_n_u32(16 * delta2);
+    uint32_t index[4];
+    int done = 0;
+    while (count >= 4) {
+        vst1q_u32(index, vshrq_n_u32(vp, 32 - COLOR_WAVE_BITS));
+        dst[0] = wave_table[index[0]];
+        dst[1] = wave_table[index[1]];
+        dst[2] = wave_table[index[2]];
+        dst[3] = wave_table[index[3]];
+        vp = vaddq_u32(vp, vd);
+        vd = vaddq_u32(vd, vdd);
+        dst += 4;
+        count -= 4;
+        done += 4;
+    }
+    phase = vgetq_lane_u32(vp, 0);
+    delta += (uint32_t)done * delta2;
+#endif
+    while (count-- > 0) {
+        *dst++ = wave_table[phase >> shift];
+        phase += delta;
+        delta += delta2;
+    }
+}
+
+// ============================================
+// Ramps and Y'CbCr
+// ============================================
+
+void color_ramp_span(uint32_t *dst, int count, const int32_t start[3], const int32_t step[3]) {
+    int32_t r = start[0];
+    int32_t g = start[1];
+    int32_t b = start[2];
+#if defined(__ARM_NEON)
+    const int32_t r4[4] = {r, r + step[0], r + 2 * step[0], r + 3 * step[0]};
+    const int32_t g4[4] = {g, g + step[1], g + 2 * step[1], g + 3 * step[1]};
+    const int32_t b4[4] = {b, b + step[2], b + 2 * step[2], b + 3 * step[2]};
+    int32x4_t vr = vld1q_s32(r4);
+    int32x4_t vg = vld1q_s32(g4);
+    int32x4_t vb = vld1q_s32(b4);
+    int32x4_t sr = vdupq_n_s32(4 * step[0]);
+    int32x4_t sg = vdupq_n_s32(4 * step[1]);
+    int32x4_t sb = vdupq_n_s32(4 * step[2]);
+    int32x4_t lo = vdupq_n_s32(0);
+    int32x4_t hi = vdupq_n_s32(255);
+    uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+    while (count >= 4) {
+        uint32x4_t cr = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(vshrq_n_s32(vr, 16), lo), hi));
+        uint32x4_t cg = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(vshrq_n_s32(vg, 16), lo), hi));
+        uint32x4_t cb = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(vshrq_n_s32(vb, 16), lo), hi));
+        uint32x4_t px = vorrq_u32(alpha, cr);
+        px = vorrq_u32(px, vshlq_n_u32(cg, 8));
+        px = vorrq_u32(px, vshlq_n_u32(cb, 16));
+        vst1q_u32(dst, px);
+        vr = vaddq_s32(vr, sr);
+        vg = vaddq_s32(vg, sg);
+        vb = vaddq_s32(vb, sb);
+        dst += 4;
+        count -= 4;
+    }
+    r = vgetq_lane_s32(vr, 0);
+    g = vgetq_lane_s32(vg, 0);
+    b = vgetq_lane_s32(vb, 0);
+#endif
+    while (count-- > 0) {
+        *dst++ = make_color_bgr(clamp_channel(r >> 16), clamp_channel(g >> 16), clamp_channel(b >> 16));
+        r += step[0];
+        g += step[1];
+        b += step[2];
+    }
+}
+
+// R'G'B' from 16.16 Y' and chroma offsets from 128
+static void ycbcr_to_rgb_fx(int64_t y, int64_t cb, int64_t cr, int32_t rgb[3]) {
+    rgb[0] = (int32_t)(y + ((YCC_R_CR * cr) >> 16));
+    rgb[1] = (int32_t)(y - ((YCC_G_CB * cb + YCC_G_CR * cr) >> 16));
+    rgb[2] = (int32_t)(y + ((YCC_B_CB * cb) >> 16));
+}
+
+uint32_t color_ycbcr709(int y, int cb, int cr) {
+    int32_t rgb[3];
+    // Round to nearest on the final shift
+    ycbcr_to_rgb_fx(((int64_t)y << 16) + 0x8000, (int64_t)(cb - 128) << 16, (int64_t)(cr - 128) << 16, rgb);
+    return make_color_bgr(clamp_channel(rgb[0] >> 16), clamp_channel(rgb[1] >> 16), clamp_channel(rgb[2] >> 16));
+}
+
+void color_to_ycbcr709(uint32_t pixel, uint8_t ycc[3]) {
+    int r = pixel & 0xFF;
+    int g = (pixel >> 8) & 0xFF;
+    int b = (pixel >> 16) & 0xFF;
+    int y = (COLOR_LUMA709_R * r + COLOR_LUMA709_G * g + COLOR_LUMA709_B * b + 5000) / 10000;
+    // Cb = (B - Y) / 1.8556, Cr = (R - Y) / 1.5748, in 16.16
+    int cb = 128 + (int)(((int64_t)(b - y) * 35318 + 0x8000) >> 16);
+    int cr = 128 + (int)(((int64_t)(r - y) * 41615 + 0x8000) >> 16);
+    ycc[0] = (uint8_t)y;
+    ycc[1] = (uint8_t)clamp_channel(cb);
+    ycc[2] = (uint8_t)clamp_channel(cr);
+}
+
+void color_ycbcr709_ramp(const int32_t ycc[3], const int32_t ycc_step[3], int32_t rgb[3], int32_t rgb_step[3]) {
+    ycbcr_to_rgb_fx((int64_t)ycc[0] + 0x8000, (int64_t)ycc[1] - (128 << 16), (int64_t)ycc[2] - (128 << 16), rgb);
+    ycbcr_to_rgb_fx(ycc_step[0], ycc_step[1], ycc_step[2], rgb_step);
+}
@@ -0,0 +1,79 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stdint.h>
+
+// Color conversions for the pattern painters.
+//
+// Everything a painter calls per pixel or per span is integer arithmetic
+// and table lookups; the tables are built once by color_init_tables()
+// (pattern_init_tables() does it). Channels are 8-bit gamma encoded
+// values unless a name says linear, in which case they are linear light
+// in 0-65535. Hue runs over COLOR_HUE_STEPS per turn, 256 per 60-degree
+// sector, so sweeps can move in steps finer than a degree.
+
+#define COLOR_HUE_STEPS 1536
+
+// Transfer curve tables map COLOR_CURVE_SIZE evenly spaced input levels to
+// 8-bit codes
+#define COLOR_CURVE_SIZE 1024
+
+// Display gammas with a table, in tenths (1.0 to 3.0)
+#define COLOR_GAMMA_MIN 10
+#define COLOR_GAMMA_MAX 30
+
+// Rec. 709 luma weights x 10000 (R, G, B)
+#define COLOR_LUMA709_R 2126
+#define COLOR_LUMA709_G 7152
+#define COLOR_LUMA709_B 722
+
+// The sine wave table holds one period in 1 << COLOR_WAVE_BITS steps
+#define COLOR_WAVE_BITS 10
+
+// Build the lookup tables; call once before any other function
+void color_init_tables(void);
+
+// HSV and HSL with saturation, value and lightness in 0-255
+uint32_t color_hsv(int hue, int s, int v);
+uint32_t color_hsl(int hue, int s, int l);
+
+// Fully saturated hues along a 16.16 fixed-point hue ramp hue, hue + step,
+// ... (wrapping every COLOR_HUE_STEPS; step must be below COLOR_HUE_STEPS)
+void color_hue_span(uint32_t *dst, int count, int32_t hue, int32_t step);
+
+// sRGB transfer function both ways
+uint16_t color_srgb_to_linear(uint8_t c);
+uint8_t color_linear_to_srgb(uint16_t linear);
+
+// Curve tables (COLOR_CURVE_SIZE entries): linear light to sRGB, CIE L*
+// (0-100, perceptually even) to sRGB, and linear light to the codes a
+// display with the given gamma (clamped to the table range) shows at that
+// light level
+const uint8_t *color_srgb_curve(void);
+const uint8_t *color_lstar_curve(void);
+const uint8_t *color_gamma_curve(int gamma_x10);
+
+// Write count pixels whose level is curve[v >> 16], v stepping by step
+// through 16.16 curve indices (clamped to the table), multiplied into the
+// channels set in mul like ramp_span()
+void color_curve_span(uint32_t *dst, int count, int32_t v, int32_t step, const uint8_t *curve, uint32_t mul);
+
+// Independent 16.16 ramps for R, G and B, each clamped to 0-255
+void color_ramp_span(uint32_t *dst, int count, const int32_t start[3], const int32_t step[3]);
+
+// Gray sine wave (codes 0-255 around 127.5) along a quadratic phase:
+// pixel i shows the wave at phase + i * delta + i * (i - 1) / 2 * delta2,
+// with one period every 2^32 and all arithmetic modulo 2^32. delta2 = 0
+// gives a plain grating. The table is built with integer arithmetic only,
+// so the output is the same on every platform.
+void color_wave_span(uint32_t *dst, int count, uint32_t phase, uint32_t delta, uint32_t delta2);
+
+// Rec. 709 Y'CbCr, full range 8-bit codes
+uint32_t color_ycbcr709(int y, int cb, int cr);
+void color_to_ycbcr709(uint32_t pixel, uint8_t ycc[3]);
+
+// Y'CbCr is linear in R'G'B', so Y'CbCr ramps (16.16 codes per pixel) are
+// R'G'B' ramps: convert a start point and a step for color_ramp_span()
+void color_ycbcr709_ramp(const int32_t ycc[3], const int32_t ycc_step[3], int32_t rgb[3], int32_t rgb_step[3]);
+
+#endif
@@ -0,0 +1,265 @@
+#include "compositor.h"
+#include "strategy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int flags;
+    int visible;
+    int has_content;       // surface holds the content for key
+    Rect rect;
+    uint64_t key;
+    uint32_t version;      // Bumped whenever the surface changes
+    uint32_t *surface;     // rect-sized, rows packed
+    int capacity;          // Pixels
+    CompositorPainter painter;    // Set for painted layers, which have no surface
+} Layer;
+
+// What a framebuffer holds of a layer
+typedef struct {
+    int shown;
+    Rect rect;
+    uint32_t version;
+} LayerCopy;
+
+static Layer layers[LAYER_COUNT];
+static LayerCopy copies[2][LAYER_COUNT];
+
+// Screen-sized drawing area shared by all layers
+static uint32_t *canvas = NULL;
+
+static int same_rect(const Rect *a, const Rect *b) {
+    return a->x0 == b->x0 && a->y0 == b->y0 && a->x1 == b->x1 && a->y1 == b->y1;
+}
+
+static int rects_overlap(const Rect *a, const Rect *b) {
+    return a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1;
+}
+
+static int rect_area(const Rect *r) {
+    return (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+static int clip_to_screen(Rect *r) {
+    if (r->x0 < 0) r->x0 = 0;
+    if (r->y0 < 0) r->y0 = 0;
+    if (r->x1 > SCREEN_WIDTH) r->x1 = SCREEN_WIDTH;
+    if (r->y1 > SCREEN_HEIGHT) r->y1 = SCREEN_HEIGHT;
+    return r->x0 < r->x1 && r->y0 < r->y1;
+}
+
+void compositor_term(void) {
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        free(layers[l].surface);
+    }
+    memset(layers, 0, sizeof(layers));
+    memset(copies, 0, sizeof(copies));
+    free(canvas);
+    canvas = NULL;
+}
+
+void compositor_set_flags(CompositorLayer layer, int flags) {
+    layers[layer].flags = flags;
+    layers[layer].visible = 0;
+    layers[layer].has_content = 0;
+}
+
+uint32_t *compositor_begin(CompositorLayer layer, const Rect *r, uint64_t key) {
+    Layer *l = &layers[layer];
+    Rect clip = *r;
+    if (!clip_to_screen(&clip)) {
+        l->visible = 0;
+        return NULL;
+    }
+
+    if (l->has_content && !l->painter && l->key == key && same_rect(&l->rect, &clip)) {
+        l->visible = 1;
+        return NULL;
+    }
+
+    int area = rect_area(&clip);
+    if (!canvas) canvas = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (canvas && area > l->capacity) {
+        uint32_t *surface = realloc(l->surface, area * sizeof(uint32_t));
+        if (surface) {
+            l->surface = surface;
+            l->capacity = area;
+        }
+    }
+    if (!canvas || area > l->capacity) {
+        l->visible = 0;
+        l->has_content = 0;
+        return NULL;
+    }
+
+    l->rect = clip;
+    l->key = key;
+    l->has_content = 0;
+    l->painter = NULL;
+    int width = clip.x1 - clip.x0;
+    for (int y = clip.y0; y < clip.y1; y++) {
+        memset(canvas + y * SCREEN_FB_WIDTH + clip.x0, 0, width * sizeof(uint32_t));
+    }
+    return canvas;
+}
+
+void compositor_end(CompositorLayer layer) {
+    Layer *l = &layers[layer];
+    int width = l->rect.x1 - l->rect.x0;
+    uint32_t *dst = l->surface;
+    for (int y = l->rect.y0; y < l->rect.y1; y++) {
+        memcpy(dst, canvas + y * SCREEN_FB_WIDTH + l->rect.x0, width * sizeof(uint32_t));
+        dst += width;
+    }
+    l->has_content = 1;
+    l->visible = 1;
+    l->version++;
+}
+
+void compositor_paint(CompositorLayer layer, const Rect *r, uint64_t key, CompositorPainter painter) {
+    Layer *l = &layers[layer];
+    Rect clip = *r;
+    if (!clip_to_screen(&clip)) {
+        l->visible = 0;
+        return;
+    }
+
+    if (!l->has_content || l->painter != painter || l->key != key || !same_rect(&l->rect, &clip)) {
+        l->rect = clip;
+        l->key = key;
+        l->painter = painter;
+        l->has_content = 1;
+        l->version++;
+    }
+    l->visible = 1;
+}
+
+void compositor_hide(CompositorLayer layer) {
+    layers[layer].visible = 0;
+}
+
+void compositor_prepare(int buffer) {
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        const Layer *layer = &layers[l];
+        LayerCopy *copy = &copies[buffer][l];
+        if (!copy->shown) continue;
+
+        // Opaque layers cover their old copy completely when redrawn in place
+        int transparent = (layer->flags & COMPOSITOR_KEYED) || layer->painter;
+        int gone = !layer->visible || !same_rect(&layer->rect, &copy->rect) ||
+                   (transparent && layer->version != copy->version);
+        if (!gone) continue;
+
+        strategy_mark_overlay(buffer, &copy->rect);
+        copy->shown = 0;
+    }
+}
+
+static void copy_layer(uint32_t *pixels, const Layer *layer) {
+    int width = layer->rect.x1 - layer->rect.x0;
+    const uint32_t *src = layer->surface;
+    for (int y = layer->rect.y0; y < layer->rect.y1; y++) {
+        uint32_t *dst = pixels + y * SCREEN_FB_WIDTH + layer->rect.x0;
+        if (layer->flags & COMPOSITOR_KEYED) {
+            for (int x = 0; x < width; x++) {
+                if (src[x] >> 24) dst[x] = src[x];
+            }
+        } else {
+            memcpy(dst, src, width * sizeof(uint32_t));
+        }
+        src += width;
+    }
+}
+
+// Paint the parts of a painted layer that lie in the dirty areas
+static int paint_dirty(uint32_t *pixels, const Layer *layer, const Rect *dirty, int dirty_count) {
+    int written = 0;
+    for (int i = 0; i < dirty_count; i++) {
+        Rect r = {
+            dirty[i].x0 > layer->rect.x0 ? dirty[i].x0 : layer->rect.x0,
+            dirty[i].y0 > layer->rect.y0 ? dirty[i].y0 : layer->rect.y0,
+            dirty[i].x1 < layer->rect.x1 ? dirty[i].x1 : layer->rect.x1,
+            dirty[i].y1 < layer->rect.y1 ? dirty[i].y1 : layer->rect.y1,
+        };
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) continue;
+        layer->painter(pixels, &r);
+        written += rect_area(&r);
+    }
+    return written;
+}
+
+int compositor_flatten(int buffer, uint32_t *pixels, const Rect *repainted, int count) {
+    // Areas where what lies under the next layer was just rewritten
+    Rect dirty[STRATEGY_MAX_REPAINTED + LAYER_COUNT];
+    int dirty_count = 0;
+    int base_intact = count >= 0;
+    for (int i = 0; i < count && i < STRATEGY_MAX_REPAINTED; i++) {
+        dirty[dirty_count++] = repainted[i];
+    }
+
+    int written = 0;
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        const Layer *layer = &layers[l];
+        LayerCopy *copy = &copies[buffer][l];
+        if (!layer->visible || !layer->has_content) {
+            copy->shown = 0;
+            continue;
+        }
+
+        int stale = !base_intact || !copy->shown || copy->version != layer->version ||
+                    !same_rect(&copy->rect, &layer->rect);
+        if (!stale && layer->painter) {
+            // What lies under it is already in the dirty list
+            written += paint_dirty(pixels, layer, dirty, dirty_count);
+            continue;
+        }
+        for (int i = 0; i < dirty_count && !stale; i++) {
+            stale = rects_overlap(&dirty[i], &layer->rect);
+        }
+        if (!stale) continue;
+
+        if (layer->painter) {
+            layer->painter(pixels, &layer->rect);
+        } else {
+            copy_layer(pixels, layer);
+        }
+        written += rect_area(&layer->rect);
+        dirty[dirty_count++] = layer->rect;
+        copy->shown = 1;
+        copy->rect = layer->rect;
+        copy->version = layer->version;
+    }
+    return written;
+}
+
+int compositor_buffer_current(int buffer) {
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        const Layer *layer = &layers[l];
+        const LayerCopy *copy = &copies[buffer][l];
+        int showing = layer->visible && layer->has_content;
+        if (!showing && !copy->shown) continue;
+        if (showing != copy->shown || copy->version != layer->version ||
+            !same_rect(&copy->rect, &layer->rect)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int compositor_visible_rects(Rect *out, int max) {
+    int count = 0;
+    for (int l = 0; l < LAYER_COUNT && count < max; l++) {
+        if (layers[l].visible && layers[l].has_content && !layers[l].painter) out[count++] = layers[l].rect;
+    }
+    return count;
+}
+
+uint64_t compositor_hash(const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t hash = 14695981039346656037ull;
+    while (size-- > 0) {
+        hash = (hash ^ *p++) * 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,98 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "display.h"
+
+// Layered compositor for everything drawn on top of the pattern.
+//
+// The pattern itself is the base layer and is owned by the render
+// strategies. Every other layer is drawn once into its own cached surface
+// and copied into a framebuffer only where that buffer does not hold it
+// yet: after the layer changed, after the base under it was repainted or
+// after a layer below it was copied again. Each of the two framebuffers is
+// tracked separately, so a static overlay costs nothing once both buffers
+// have it, whatever the number of layers.
+//
+// A painted layer has no surface. Its painter draws straight into the
+// framebuffer and is only called for the parts of the layer that need it,
+// so a layer that is mostly transparent (a few markers spread over the
+// screen) costs no more than what it draws. Painters must give the same
+// pixels however the area is split, and painting a pixel twice must give
+// the same result as painting it once.
+//
+// A frame goes:
+//
+//   compositor_begin()/compositor_end(), compositor_paint() or
+//   compositor_hide() per layer
+//   compositor_prepare(buffer)
+//   strategy_render(buffer, ...)
+//   compositor_flatten(buffer, pixels, <rects strategy_repainted() reports>)
+//
+// Layers are hidden, moved or given new keyed content before
+// compositor_prepare(), which has the strategies repair the base where
+// they used to be. An opaque layer may be redrawn in place after it.
+
+typedef enum {
+    LAYER_GEOMETRY,     // Shapes drawn over the pattern (defect markers)
+    LAYER_CURSOR,
+    LAYER_INDICATOR,    // Pattern number and hint
+    LAYER_HUD,          // Profiler HUD
+    LAYER_TIMECODE,     // Binary timecode strip
+    LAYER_COUNT
+} CompositorLayer;
+
+// Layer flags
+#define COMPOSITOR_KEYED 0x1    // Pixels with alpha 0 are transparent
+
+// Draws a painted layer's pixels that fall inside clip
+typedef void (*CompositorPainter)(uint32_t *pixels, const Rect *clip);
+
+// Free the canvas and layer surfaces
+void compositor_term(void);
+
+// Set a layer's flags; this hides it until it is drawn again
+void compositor_set_flags(CompositorLayer layer, int flags);
+
+// Start drawing a layer covering r (clipped to the screen). key identifies
+// the content: if the layer already shows content with this key over the
+// same area NULL is returned and nothing needs drawing. Otherwise returns
+// a screen-sized canvas (pitch SCREEN_FB_WIDTH) with r cleared to 0; draw
+// the layer in screen coordinates and call compositor_end(). Only what is
+// inside r is kept.
+uint32_t *compositor_begin(CompositorLayer layer, const Rect *r, uint64_t key);
+
+// Store what was drawn since compositor_begin() in the layer's surface
+void compositor_end(CompositorLayer layer);
+
+// Show a painted layer over r (clipped to the screen). key identifies
+// the content: a new key repaints the layer everywhere.
+void compositor_paint(CompositorLayer layer, const Rect *r, uint64_t key, CompositorPainter painter);
+
+// Stop showing a layer
+void compositor_hide(CompositorLayer layer);
+
+// Have the strategies repair the base wherever `buffer` (0 or 1) shows a
+// layer that is gone, moved or changed under a keyed or painted layer
+void compositor_prepare(int buffer);
+
+// Copy layers into `buffer` where it does not hold them already.
+// repainted lists the areas of the base the render redrew; a count below
+// 0 means it redrew everything and every visible layer is copied.
+// Returns the number of pixels written.
+int compositor_flatten(int buffer, uint32_t *pixels, const Rect *repainted, int count);
+
+// Non-zero if `buffer` holds every visible layer as it is now and nothing
+// of a layer that is gone, moved or changed
+int compositor_buffer_current(int buffer);
+
+// Areas of the visible surface layers, bottom to top; returns how many.
+// Painted layers are left out: their area can be the whole screen while
+// they draw only a few pixels of it.
+int compositor_visible_rects(Rect *out, int max);
+
+// FNV-1a over size bytes, for building layer keys
+uint64_t compositor_hash(const void *data, size_t size);
+
+#endif
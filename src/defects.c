@@ -0,0 +1,447 @@
+#include "defects.h"
+#include "compositor.h"
+#include "evlog.h"
+#include "font.h"
+#include "raster.h"
+#include "storage.h"
+
+#include <psp2/ctrl.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/openpsid.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUCKETS_X    (SCREEN_WIDTH / DEFECTS_BUCKET)
+#define BUCKETS_Y    (SCREEN_HEIGHT / DEFECTS_BUCKET)
+#define BUCKET_COUNT (BUCKETS_X * BUCKETS_Y)
+
+#define RING         4     // Pixel markers are square rings this far out, so the pixel stays visible
+#define CROSS_GAP    3     // Cursor arms start this far from the cursor pixel
+#define CROSS_ARM    10
+#define REPEAT_DELAY 20    // Frames a direction is held before the cursor runs
+#define REPEAT_STEP  4     // Pixels per frame while it runs
+
+_Static_assert(SCREEN_WIDTH % DEFECTS_BUCKET == 0 && SCREEN_HEIGHT % DEFECTS_BUCKET == 0,
+               "buckets must tile the screen");
+_Static_assert(DEFECTS_MAX <= 65536, "marker indices are 16 bits");
+
+static const uint32_t kind_colors[DEFECT_KIND_COUNT] = {COLOR_CYAN, COLOR_MAGENTA, COLOR_YELLOW};
+
+static DefectMarker markers[DEFECTS_MAX];
+static int marker_count = 0;
+static uint32_t map_version = 0;     // Bumped on every change; the layer key
+static int unsaved = 0;
+static char map_path[128];
+
+// Grid index: the markers drawing into bucket b are entries[bucket_start[b]]
+// up to entries[bucket_start[b + 1]], in map order
+static uint32_t bucket_start[BUCKET_COUNT + 1];
+static uint32_t bucket_next[BUCKET_COUNT];
+static uint16_t *entries = NULL;
+static uint32_t entry_capacity = 0;
+static Rect bounds;                  // Everything the markers draw
+
+// Marking mode
+static int editing = 0;
+static int cursor_x = SCREEN_WIDTH / 2;
+static int cursor_y = SCREEN_HEIGHT / 2;
+static int anchored = 0;             // First corner of a region is set
+static int anchor_x, anchor_y;
+static int held_frames = 0;
+
+// ============================================
+// Index
+// ============================================
+
+// Pixels a marker draws
+static Rect marker_extent(const DefectMarker *m) {
+    Rect r = {m->x0, m->y0, m->x1, m->y1};
+    if (m->kind != DEFECT_REGION) {
+        r.x0 -= RING;
+        r.y0 -= RING;
+        r.x1 += RING;
+        r.y1 += RING;
+    }
+    if (r.x0 < 0) r.x0 = 0;
+    if (r.y0 < 0) r.y0 = 0;
+    if (r.x1 > SCREEN_WIDTH) r.x1 = SCREEN_WIDTH;
+    if (r.y1 > SCREEN_HEIGHT) r.y1 = SCREEN_HEIGHT;
+    return r;
+}
+
+// Buckets a rect inside the screen touches, inclusive
+static void bucket_range(const Rect *r, int *bx0, int *by0, int *bx1, int *by1) {
+    *bx0 = r->x0 / DEFECTS_BUCKET;
+    *by0 = r->y0 / DEFECTS_BUCKET;
+    *bx1 = (r->x1 - 1) / DEFECTS_BUCKET;
+    *by1 = (r->y1 - 1) / DEFECTS_BUCKET;
+}
+
+// Counting sort of (bucket, marker) pairs; returns < 0 if the entries do
+// not fit in memory
+static int build_index(void) {
+    memset(bucket_start, 0, sizeof(bucket_start));
+    bounds = (Rect){SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0};
+    for (int i = 0; i < marker_count; i++) {
+        Rect e = marker_extent(&markers[i]);
+        int bx0, by0, bx1, by1;
+        bucket_range(&e, &bx0, &by0, &bx1, &by1);
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                bucket_start[by * BUCKETS_X + bx + 1]++;
+            }
+        }
+        if (e.x0 < bounds.x0) bounds.x0 = e.x0;
+        if (e.y0 < bounds.y0) bounds.y0 = e.y0;
+        if (e.x1 > bounds.x1) bounds.x1 = e.x1;
+        if (e.y1 > bounds.y1) bounds.y1 = e.y1;
+    }
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+
+    uint32_t total = bucket_start[BUCKET_COUNT];
+    if (total > entry_capacity) {
+        uint32_t capacity = total + total / 2;
+        uint16_t *grown = realloc(entries, capacity * sizeof(uint16_t));
+        if (!grown) return -1;
+        entries = grown;
+        entry_capacity = capacity;
+    }
+
+    memcpy(bucket_next, bucket_start, sizeof(bucket_next));
+    for (int i = 0; i < marker_count; i++) {
+        Rect e = marker_extent(&markers[i]);
+        int bx0, by0, bx1, by1;
+        bucket_range(&e, &bx0, &by0, &bx1, &by1);
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                entries[bucket_next[by * BUCKETS_X + bx]++] = (uint16_t)i;
+            }
+        }
+    }
+    return 0;
+}
+
+// Last marker (in map order) whose marked pixels include (x, y); with
+// pixels_only set, only single-pixel markers count
+static int find_marker(int x, int y, int pixels_only) {
+    int b = (y / DEFECTS_BUCKET) * BUCKETS_X + x / DEFECTS_BUCKET;
+    for (uint32_t e = bucket_start[b + 1]; e-- > bucket_start[b];) {
+        const DefectMarker *m = &markers[entries[e]];
+        if (pixels_only && m->kind == DEFECT_REGION) continue;
+        if (x >= m->x0 && x < m->x1 && y >= m->y0 && y < m->y1) return entries[e];
+    }
+    return -1;
+}
+
+static void map_changed(void) {
+    map_version++;
+    unsaved = 1;
+}
+
+static void add_marker(int x0, int y0, int x1, int y1, DefectKind kind) {
+    if (marker_count >= DEFECTS_MAX) {
+        evlog_printf("defects: map is full (%d markers)", DEFECTS_MAX);
+        return;
+    }
+    DefectMarker *m = &markers[marker_count++];
+    memset(m, 0, sizeof(*m));
+    m->x0 = (uint16_t)x0;
+    m->y0 = (uint16_t)y0;
+    m->x1 = (uint16_t)x1;
+    m->y1 = (uint16_t)y1;
+    m->kind = (uint8_t)kind;
+    if (build_index() < 0) {
+        evlog_printf("defects: out of memory for the index, marker dropped");
+        marker_count--;
+        build_index();
+        return;
+    }
+    map_changed();
+}
+
+static void remove_marker(int i) {
+    memmove(&markers[i], &markers[i + 1], (marker_count - i - 1) * sizeof(DefectMarker));
+    marker_count--;
+    build_index();    // Never needs more entries than before
+    map_changed();
+}
+
+// ============================================
+// Map file
+// ============================================
+
+static void make_map_path(void) {
+    SceKernelOpenPsId id;
+    if (sceKernelGetOpenPsId(&id) < 0) {
+        storage_path(map_path, sizeof(map_path), "defects.bin");
+        return;
+    }
+    char name[48] = "defects_";
+    for (int i = 0; i < 16; i++) {
+        snprintf(name + 8 + 2 * i, 3, "%02x", (uint8_t)id.id[i]);
+    }
+    strcat(name, ".bin");
+    storage_path(map_path, sizeof(map_path), name);
+}
+
+static int valid_marker(const DefectMarker *m) {
+    return m->kind < DEFECT_KIND_COUNT && m->x0 < m->x1 && m->y0 < m->y1 &&
+           m->x1 <= SCREEN_WIDTH && m->y1 <= SCREEN_HEIGHT;
+}
+
+// Returns the number of markers read, 0 if there is no map yet
+static int load_map(void) {
+    SceUID fd = sceIoOpen(map_path, SCE_O_RDONLY, 0);
+    if (fd < 0) return 0;
+    DefectFileHeader header;
+    int ok = sceIoRead(fd, &header, sizeof(header)) == (int)sizeof(header) &&
+             header.magic == DEFECTS_FILE_MAGIC && header.version == DEFECTS_FILE_VERSION &&
+             header.marker_size == sizeof(DefectMarker) && header.count <= DEFECTS_MAX;
+    int size = ok ? (int)(header.count * sizeof(DefectMarker)) : 0;
+    ok = ok && sceIoRead(fd, markers, size) == size;
+    sceIoClose(fd);
+    for (uint32_t i = 0; ok && i < header.count; i++) {
+        ok = valid_marker(&markers[i]);
+    }
+    if (!ok) return -1;
+    marker_count = (int)header.count;
+    return marker_count;
+}
+
+static int save_map(void) {
+    DefectFileHeader header = {
+        .magic = DEFECTS_FILE_MAGIC,
+        .version = DEFECTS_FILE_VERSION,
+        .marker_size = sizeof(DefectMarker),
+        .count = (uint32_t)marker_count,
+    };
+    SceUID fd = sceIoOpen(map_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) return -1;
+    int size = marker_count * (int)sizeof(DefectMarker);
+    int ok = sceIoWrite(fd, &header, sizeof(header)) == (int)sizeof(header) &&
+             sceIoWrite(fd, markers, size) == size;
+    sceIoClose(fd);
+    return ok ? 0 : -1;
+}
+
+static void save_if_changed(void) {
+    if (!unsaved) return;
+    if (save_map() < 0) {
+        evlog_printf("defects: could not write %s", map_path);
+        return;
+    }
+    unsaved = 0;
+    evlog_printf("defects: %d markers saved", marker_count);
+}
+
+int defects_init(void) {
+    make_map_path();
+    compositor_set_flags(LAYER_CURSOR, COMPOSITOR_KEYED);
+    int loaded = load_map();
+    if (loaded < 0 || build_index() < 0) {
+        evlog_printf("defects: could not load %s, starting with an empty map", map_path);
+        marker_count = 0;
+        build_index();
+        return -1;
+    }
+    if (loaded > 0) evlog_printf("defects: %d markers loaded", loaded);
+    return 0;
+}
+
+void defects_term(void) {
+    save_if_changed();
+    free(entries);
+    entries = NULL;
+    entry_capacity = 0;
+}
+
+int defects_count(void) {
+    return marker_count;
+}
+
+// ============================================
+// Drawing
+// ============================================
+
+// One pixel wide outline just inside [x0, x1) x [y0, y1)
+static void outline(uint32_t *pixels, const Rect *clip, int x0, int y0, int x1, int y1, uint32_t color) {
+    raster_hline(pixels, clip, x0, x1, y0, color);
+    raster_hline(pixels, clip, x0, x1, y1 - 1, color);
+    raster_vline(pixels, clip, x0, y0 + 1, y1 - 1, color);
+    raster_vline(pixels, clip, x1 - 1, y0 + 1, y1 - 1, color);
+}
+
+// Colored outline with a black one inside it, visible on any pattern
+static void draw_marker(uint32_t *pixels, const Rect *clip, const DefectMarker *m) {
+    int pad = m->kind == DEFECT_REGION ? 0 : RING;
+    int x0 = m->x0 - pad, y0 = m->y0 - pad;
+    int x1 = m->x1 + pad, y1 = m->y1 + pad;
+    outline(pixels, clip, x0, y0, x1, y1, kind_colors[m->kind]);
+    if (x1 - x0 > 2 && y1 - y0 > 2) outline(pixels, clip, x0 + 1, y0 + 1, x1 - 1, y1 - 1, COLOR_BLACK);
+}
+
+// Painter of the map layer. Each bucket's markers are drawn clipped to
+// the bucket, so a pixel always gets the same markers in the same order
+// however the layer is split up.
+static void paint_markers(uint32_t *pixels, const Rect *clip) {
+    int bx0, by0, bx1, by1;
+    bucket_range(clip, &bx0, &by0, &bx1, &by1);
+    for (int by = by0; by <= by1; by++) {
+        for (int bx = bx0; bx <= bx1; bx++) {
+            int b = by * BUCKETS_X + bx;
+            if (bucket_start[b] == bucket_start[b + 1]) continue;
+            Rect cell = {bx * DEFECTS_BUCKET, by * DEFECTS_BUCKET,
+                         (bx + 1) * DEFECTS_BUCKET, (by + 1) * DEFECTS_BUCKET};
+            if (cell.x0 < clip->x0) cell.x0 = clip->x0;
+            if (cell.y0 < clip->y0) cell.y0 = clip->y0;
+            if (cell.x1 > clip->x1) cell.x1 = clip->x1;
+            if (cell.y1 > clip->y1) cell.y1 = clip->y1;
+            for (uint32_t e = bucket_start[b]; e < bucket_start[b + 1]; e++) {
+                draw_marker(pixels, &cell, &markers[entries[e]]);
+            }
+        }
+    }
+}
+
+static void grow(Rect *r, int x0, int y0, int x1, int y1) {
+    if (x0 < r->x0) r->x0 = x0;
+    if (y0 < r->y0) r->y0 = y0;
+    if (x1 > r->x1) r->x1 = x1;
+    if (y1 > r->y1) r->y1 = y1;
+}
+
+// Crosshair around the cursor pixel, the pending region and a position
+// readout, on the keyed cursor layer
+static void update_cursor(void) {
+    char label[48];
+    snprintf(label, sizeof(label), "X %d Y %d  %d MARKED", cursor_x, cursor_y, marker_count);
+    int label_w = get_string_width(label, 1) + 8;
+    int label_h = 14;
+    int lx = cursor_x + CROSS_ARM + 4;
+    int ly = cursor_y + CROSS_ARM + 4;
+    if (lx + label_w > SCREEN_WIDTH) lx = cursor_x - CROSS_ARM - 4 - label_w;
+    if (ly + label_h > SCREEN_HEIGHT) ly = cursor_y - CROSS_ARM - 4 - label_h;
+
+    Rect area = {cursor_x - CROSS_ARM - 1, cursor_y - CROSS_ARM - 1,
+                 cursor_x + CROSS_ARM + 2, cursor_y + CROSS_ARM + 2};
+    grow(&area, lx, ly, lx + label_w, ly + label_h);
+    int rx0 = 0, ry0 = 0, rx1 = 0, ry1 = 0;
+    if (anchored) {
+        rx0 = anchor_x < cursor_x ? anchor_x : cursor_x;
+        ry0 = anchor_y < cursor_y ? anchor_y : cursor_y;
+        rx1 = (anchor_x > cursor_x ? anchor_x : cursor_x) + 1;
+        ry1 = (anchor_y > cursor_y ? anchor_y : cursor_y) + 1;
+        grow(&area, rx0, ry0, rx1, ry1);
+    }
+
+    int key[6] = {cursor_x, cursor_y, anchored, anchor_x, anchor_y, marker_count};
+    uint32_t *pixels = compositor_begin(LAYER_CURSOR, &area, compositor_hash(key, sizeof(key)));
+    if (!pixels) return;
+
+    const Rect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    if (anchored) outline(pixels, &screen, rx0, ry0, rx1, ry1, kind_colors[DEFECT_REGION]);
+    // Arms in white with black edges
+    for (int side = -1; side <= 1; side += 2) {
+        int a = cursor_x + side * CROSS_GAP;
+        int b = cursor_x + side * CROSS_ARM;
+        int x0 = a < b ? a : b, x1 = (a < b ? b : a) + 1;
+        raster_hline(pixels, &screen, x0, x1, cursor_y - 1, COLOR_BLACK);
+        raster_hline(pixels, &screen, x0, x1, cursor_y + 1, COLOR_BLACK);
+        raster_hline(pixels, &screen, x0, x1, cursor_y, COLOR_WHITE);
+        a = cursor_y + side * CROSS_GAP;
+        b = cursor_y + side * CROSS_ARM;
+        int y0 = a < b ? a : b, y1 = (a < b ? b : a) + 1;
+        raster_vline(pixels, &screen, cursor_x - 1, y0, y1, COLOR_BLACK);
+        raster_vline(pixels, &screen, cursor_x + 1, y0, y1, COLOR_BLACK);
+        raster_vline(pixels, &screen, cursor_x, y0, y1, COLOR_WHITE);
+    }
+    draw_box(pixels, lx, ly, label_w, label_h, 0xD0000000, COLOR_DARK_GRAY);
+    draw_string(pixels, lx + 4, ly + 4, label, 1, COLOR_WHITE, 0, 0);
+    compositor_end(LAYER_CURSOR);
+}
+
+void defects_update_layers(int show) {
+    if ((show || editing) && marker_count > 0) {
+        compositor_paint(LAYER_GEOMETRY, &bounds, map_version, paint_markers);
+    } else {
+        compositor_hide(LAYER_GEOMETRY);
+    }
+    if (editing) {
+        update_cursor();
+    } else {
+        compositor_hide(LAYER_CURSOR);
+    }
+}
+
+// ============================================
+// Marking
+// ============================================
+
+void defects_set_editing(int on) {
+    editing = on;
+    anchored = 0;
+    held_frames = 0;
+    if (!on) save_if_changed();
+}
+
+int defects_editing(void) {
+    return editing;
+}
+
+// Mark the cursor pixel as `kind`; marking it the same way again clears it
+static void toggle_pixel(DefectKind kind) {
+    int i = find_marker(cursor_x, cursor_y, 1);
+    if (i < 0) {
+        add_marker(cursor_x, cursor_y, cursor_x + 1, cursor_y + 1, kind);
+    } else if (markers[i].kind == kind) {
+        remove_marker(i);
+    } else {
+        markers[i].kind = (uint8_t)kind;
+        map_changed();
+    }
+}
+
+void defects_edit(uint32_t pressed, uint32_t held) {
+    // One pixel per press; held, the cursor runs
+    uint32_t dirs = held & (SCE_CTRL_LEFT | SCE_CTRL_RIGHT | SCE_CTRL_UP | SCE_CTRL_DOWN);
+    held_frames = dirs ? held_frames + 1 : 0;
+    uint32_t moving = held_frames > REPEAT_DELAY ? dirs : 0;
+    int step = held_frames > REPEAT_DELAY ? REPEAT_STEP : 1;
+    moving |= pressed & dirs;
+    if (moving & SCE_CTRL_LEFT) cursor_x -= step;
+    if (moving & SCE_CTRL_RIGHT) cursor_x += step;
+    if (moving & SCE_CTRL_UP) cursor_y -= step;
+    if (moving & SCE_CTRL_DOWN) cursor_y += step;
+    if (cursor_x < 0) cursor_x = 0;
+    if (cursor_x >= SCREEN_WIDTH) cursor_x = SCREEN_WIDTH - 1;
+    if (cursor_y < 0) cursor_y = 0;
+    if (cursor_y >= SCREEN_HEIGHT) cursor_y = SCREEN_HEIGHT - 1;
+
+    if (pressed & SCE_CTRL_CROSS) toggle_pixel(DEFECT_DEAD);
+    if (pressed & SCE_CTRL_CIRCLE) toggle_pixel(DEFECT_STUCK);
+    if (pressed & SCE_CTRL_SQUARE) {
+        if (!anchored) {
+            anchored = 1;
+            anchor_x = cursor_x;
+            anchor_y = cursor_y;
+        } else {
+            anchored = 0;
+            add_marker(anchor_x < cursor_x ? anchor_x : cursor_x, anchor_y < cursor_y ? anchor_y : cursor_y,
+                       (anchor_x > cursor_x ? anchor_x : cursor_x) + 1,
+                       (anchor_y > cursor_y ? anchor_y : cursor_y) + 1, DEFECT_REGION);
+        }
+    }
+    if (pressed & SCE_CTRL_TRIANGLE) {
+        if (anchored) {
+            anchored = 0;
+        } else {
+            int i;
+            while ((i = find_marker(cursor_x, cursor_y, 0)) >= 0) {
+                remove_marker(i);
+            }
+        }
+    }
+}
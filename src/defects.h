@@ -0,0 +1,70 @@
+#ifndef DEFECTS_H
+#define DEFECTS_H
+
+#include <stdint.h>
+#include "display.h"
+
+// Panel defect map.
+//
+// Dead pixels, stuck pixels and faulty regions found while inspecting are
+// marked with an on-screen cursor and kept per console (by its OpenPSID)
+// in APP_DATA_DIR/defects_<id>.bin. The map is shown as a painted
+// compositor layer over any pattern.
+//
+// Markers are indexed in a grid of DEFECTS_BUCKET pixel buckets, each
+// listing the markers that draw into it, so painting an area only visits
+// the markers near it: a partial repaint of the pattern costs what lies
+// inside the repainted rects, and a static frame costs nothing however
+// large the map is.
+
+#define DEFECTS_MAX    8192
+#define DEFECTS_BUCKET 32
+
+#define DEFECTS_FILE_MAGIC   0x54434644   // "DFCT"
+#define DEFECTS_FILE_VERSION 1
+
+typedef enum {
+    DEFECT_DEAD,      // Pixel that stays dark
+    DEFECT_STUCK,     // Pixel that stays lit
+    DEFECT_REGION,    // Area with any other fault (mura, dust, burn-in)
+    DEFECT_KIND_COUNT
+} DefectKind;
+
+// One marker as stored in the map file
+typedef struct {
+    uint16_t x0, y0, x1, y1;    // Marked pixels, half-open
+    uint8_t kind;
+    uint8_t reserved[3];
+} DefectMarker;
+
+// defects_<id>.bin: this header, then count DefectMarker entries
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t marker_size;
+    uint32_t count;
+    uint32_t reserved;
+} DefectFileHeader;
+
+// Load this console's map; returns < 0 if it could not be read (an
+// empty map is used then)
+int defects_init(void);
+
+// Save the map if it changed and free the index
+void defects_term(void);
+
+// Marking mode: the D-pad moves a cursor (held, it runs), X marks a dead
+// pixel, O a stuck pixel, [] sets the corners of a region and /\ removes
+// the markers under the cursor
+void defects_set_editing(int on);
+int defects_editing(void);
+
+// Handle one frame of input while marking
+void defects_edit(uint32_t pressed, uint32_t held);
+
+// Show or hide the map layer; the cursor layer follows marking mode
+void defects_update_layers(int show);
+
+int defects_count(void);
+
+#endif
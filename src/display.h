@@ -0,0 +1,39 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+// Host tools may build the painters for other display modes
+#ifndef SCREEN_WIDTH
+#define SCREEN_WIDTH    960
+#define SCREEN_HEIGHT   544
+#define SCREEN_FB_WIDTH 960
+#endif
+#define SCREEN_FB_SIZE  (2 * 1024 * 1024)
+
+// One refresh at 59.94 Hz
+#define SCREEN_REFRESH_US 16683
+
+// Colors in BGR format (Vita framebuffer format)
+#define COLOR_BLACK   0xFF000000
+#define COLOR_WHITE   0xFFFFFFFF
+#define COLOR_RED     0xFF0000FF
+#define COLOR_GREEN   0xFF00FF00
+#define COLOR_BLUE    0xFFFF0000
+#define COLOR_CYAN    0xFFFFFF00
+#define COLOR_MAGENTA 0xFFFF00FF
+#define COLOR_YELLOW  0xFF00FFFF
+#define COLOR_GRAY    0xFF808080
+#define COLOR_DARK_GRAY 0xFF404040
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1)
+typedef struct {
+    int x0, y0;
+    int x1, y1;
+} Rect;
+
+static inline uint32_t make_color_bgr(uint8_t r, uint8_t g, uint8_t b) {
+    return 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include "evlog.h"
+#include "storage.h"
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define EVLOG_BUFFER_SIZE (16 * 1024)
+#define EVLOG_LINE_MAX    256
+
+static char log_buffer[EVLOG_BUFFER_SIZE];
+static int log_used = 0;
+static int log_dropped = 0;
+static SceUID log_lock = -1;
+static SceUID flush_lock = -1;
+
+static void lock(void) {
+    if (log_lock >= 0) sceKernelWaitSema(log_lock, 1, NULL);
+}
+
+static void unlock(void) {
+    if (log_lock >= 0) sceKernelSignalSema(log_lock, 1);
+}
+
+void evlog_init(void) {
+    log_lock = sceKernelCreateSema("evlog", 0, 1, 1, NULL);
+    flush_lock = sceKernelCreateSema("evlog_flush", 0, 1, 1, NULL);
+    log_used = 0;
+    log_dropped = 0;
+}
+
+void evlog_printf(const char *fmt, ...) {
+    char line[EVLOG_LINE_MAX];
+    SceUInt64 now = sceKernelGetProcessTimeWide();
+    int len = snprintf(line, sizeof(line), "[%7u.%03u] ",
+                       (unsigned)(now / 1000000), (unsigned)((now / 1000) % 1000));
+
+    va_list args;
+    va_start(args, fmt);
+    len += vsnprintf(line + len, sizeof(line) - len, fmt, args);
+    va_end(args);
+
+    if (len > EVLOG_LINE_MAX - 2) len = EVLOG_LINE_MAX - 2;
+    line[len++] = '\n';
+
+    lock();
+    if (log_used + len <= EVLOG_BUFFER_SIZE) {
+        for (int i = 0; i < len; i++) {
+            log_buffer[log_used + i] = line[i];
+        }
+        log_used += len;
+    } else {
+        log_dropped++;
+    }
+    unlock();
+}
+
+void evlog_flush(void) {
+    static char pending[EVLOG_BUFFER_SIZE];
+    int pending_len;
+    int dropped;
+
+    if (flush_lock >= 0) sceKernelWaitSema(flush_lock, 1, NULL);
+
+    // Copy out under the lock so writers are never blocked on file I/O
+    lock();
+    pending_len = log_used;
+    dropped = log_dropped;
+    for (int i = 0; i < pending_len; i++) {
+        pending[i] = log_buffer[i];
+    }
+    log_used = 0;
+    log_dropped = 0;
+    unlock();
+
+    if (pending_len > 0 || dropped > 0) {
+        char path[128];
+        storage_path(path, sizeof(path), "events.log");
+        SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND, 0777);
+        if (fd >= 0) {
+            sceIoWrite(fd, pending, pending_len);
+            if (dropped > 0) {
+                char note[64];
+                int len = snprintf(note, sizeof(note), "(%d log lines dropped)\n", dropped);
+                sceIoWrite(fd, note, len);
+            }
+            sceIoClose(fd);
+        }
+    }
+
+    if (flush_lock >= 0) sceKernelSignalSema(flush_lock, 1);
+}
@@ -0,0 +1,12 @@
+#ifndef EVLOG_H
+#define EVLOG_H
+
+// Event log: lines are buffered in memory with a process-time stamp and
+// appended to APP_DATA_DIR/events.log by evlog_flush(). Safe to call from
+// any thread; lines that do not fit before the next flush are dropped.
+
+void evlog_init(void);
+void evlog_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void evlog_flush(void);
+
+#endif
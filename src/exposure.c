@@ -0,0 +1,466 @@
+#include "exposure.h"
+#include "evlog.h"
+#include "font.h"
+#include "span.h"
+#include "storage.h"
+
+#include <psp2/display.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUEUE_SIZE 64
+
+// A state that stays up longer than this is integrated in slices, so the
+// map keeps up with long static patterns
+#define MAX_DWELL_VBLANKS 60
+
+// The worker saves the map after every this many integrated vblanks (about
+// five minutes), so a session that is never quit cleanly keeps most of it
+#define SAVE_INTERVAL_VBLANKS (5 * 60 * 60)
+
+// How long exposure_checkpoint() waits for the worker to catch up
+#define CHECKPOINT_WAIT_US 200000
+
+typedef struct {
+    int pattern;
+    PatternArgs args;
+    int state;
+    uint32_t vblanks;
+} ExposureJob;
+
+// Accumulators, all guarded by acc_lock. A tile's total is
+// tiles + TILE * (columns[tx] + rows[ty]) + TILE * TILE * uniform.
+static uint64_t tiles[EXPOSURE_TILES_Y][EXPOSURE_TILES_X][3];
+static uint64_t columns[EXPOSURE_TILES_X][3];  // Per pixel row of the tile
+static uint64_t rows[EXPOSURE_TILES_Y][3];     // Per pixel column of the tile
+static uint64_t uniform[3];                    // Per pixel
+static uint64_t total_vblanks = 0;
+
+// Worker-only scratch
+static uint32_t frame_tiles[EXPOSURE_TILES_Y][EXPOSURE_TILES_X][3];
+static uint32_t *scratch = NULL;
+
+static ExposureJob queue[QUEUE_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+
+static SceUID acc_lock = -1;
+static SceUID queue_lock = -1;
+static SceUID queue_items = -1;
+static SceUID save_lock = -1;     // exposure_save() runs on both threads
+static SceUID worker = -1;
+static int quitting = 0;
+
+// Main thread: the state currently on screen
+static ExposureJob current;
+static int current_valid = 0;
+static int current_vcount = 0;
+static uint64_t dropped_vblanks = 0;
+static uint64_t queued_vblanks = 0;
+
+static uint32_t jobs_by_kind[4];    // solid, column profile, row profile, full frame
+
+static const Rect full_screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+static void add_channels(uint64_t acc[3], uint32_t color, uint32_t weight) {
+    acc[0] += (uint64_t)(color & 0xFF) * weight;
+    acc[1] += (uint64_t)((color >> 8) & 0xFF) * weight;
+    acc[2] += (uint64_t)((color >> 16) & 0xFF) * weight;
+}
+
+#if defined(__ARM_NEON)
+static inline uint32_t sum_u16x8(uint16x8_t v) {
+    uint64x2_t s = vpaddlq_u32(vpaddlq_u16(v));
+    return (uint32_t)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+#endif
+
+// The NEON path loads one tile row with a single vld4_u8
+_Static_assert(EXPOSURE_TILE == 8, "sum_block assumes 8 pixel tiles");
+
+// Per-channel sums of EXPOSURE_TILE pixels of each of `lines` rows
+static void sum_block(const uint32_t *src, int lines, uint32_t out[3]) {
+#if defined(__ARM_NEON)
+    uint16x8_t r = vdupq_n_u16(0);
+    uint16x8_t g = r;
+    uint16x8_t b = r;
+    for (int y = 0; y < lines; y++) {
+        uint8x8x4_t px = vld4_u8((const uint8_t *)(src + y * SCREEN_FB_WIDTH));
+        r = vaddw_u8(r, px.val[0]);
+        g = vaddw_u8(g, px.val[1]);
+        b = vaddw_u8(b, px.val[2]);
+    }
+    out[0] = sum_u16x8(r);
+    out[1] = sum_u16x8(g);
+    out[2] = sum_u16x8(b);
+#else
+    out[0] = out[1] = out[2] = 0;
+    for (int y = 0; y < lines; y++) {
+        const uint32_t *p = src + y * SCREEN_FB_WIDTH;
+        for (int x = 0; x < EXPOSURE_TILE; x++) {
+            out[0] += p[x] & 0xFF;
+            out[1] += (p[x] >> 8) & 0xFF;
+            out[2] += (p[x] >> 16) & 0xFF;
+        }
+    }
+#endif
+}
+
+static void integrate_full(const PatternDesc *desc, const ExposureJob *job) {
+    pattern_render(scratch, &full_screen, desc, &job->args, job->state);
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        const uint32_t *band = scratch + ty * EXPOSURE_TILE * SCREEN_FB_WIDTH;
+        for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+            sum_block(band + tx * EXPOSURE_TILE, EXPOSURE_TILE, frame_tiles[ty][tx]);
+        }
+    }
+
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+            for (int c = 0; c < 3; c++) {
+                tiles[ty][tx][c] += (uint64_t)frame_tiles[ty][tx][c] * job->vblanks;
+            }
+        }
+    }
+    sceKernelSignalSema(acc_lock, 1);
+}
+
+// All rows identical: one rasterized row gives every tile column
+static void integrate_row(const PatternDesc *desc, const ExposureJob *job) {
+    Rect row = {0, 0, SCREEN_WIDTH, 1};
+    pattern_render(scratch, &row, desc, &job->args, job->state);
+    for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+        sum_block(scratch + tx * EXPOSURE_TILE, 1, frame_tiles[0][tx]);
+    }
+
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+        for (int c = 0; c < 3; c++) {
+            columns[tx][c] += (uint64_t)frame_tiles[0][tx][c] * job->vblanks;
+        }
+    }
+    sceKernelSignalSema(acc_lock, 1);
+}
+
+// All columns identical: one rasterized column gives every tile row
+static void integrate_column(const PatternDesc *desc, const ExposureJob *job) {
+    Rect column = {0, 0, 1, SCREEN_HEIGHT};
+    uint32_t sums[EXPOSURE_TILES_Y][3];
+    pattern_render(scratch, &column, desc, &job->args, job->state);
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        sums[ty][0] = sums[ty][1] = sums[ty][2] = 0;
+        for (int y = ty * EXPOSURE_TILE; y < (ty + 1) * EXPOSURE_TILE; y++) {
+            uint32_t p = scratch[y * SCREEN_FB_WIDTH];
+            sums[ty][0] += p & 0xFF;
+            sums[ty][1] += (p >> 8) & 0xFF;
+            sums[ty][2] += (p >> 16) & 0xFF;
+        }
+    }
+
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        for (int c = 0; c < 3; c++) {
+            rows[ty][c] += (uint64_t)sums[ty][c] * job->vblanks;
+        }
+    }
+    sceKernelSignalSema(acc_lock, 1);
+}
+
+static void integrate(const ExposureJob *job) {
+    const PatternDesc *desc = pattern_get(job->pattern);
+    if (!desc) return;
+
+    if (desc->flags & PATTERN_SOLID) {
+        uint32_t color = desc->solid_color(&job->args, job->state);
+        sceKernelWaitSema(acc_lock, 1, NULL);
+        add_channels(uniform, color, job->vblanks);
+        sceKernelSignalSema(acc_lock, 1);
+        jobs_by_kind[0]++;
+    } else if (desc->flags & PATTERN_ROWS_SAME) {
+        integrate_row(desc, job);
+        jobs_by_kind[1]++;
+    } else if (desc->flags & PATTERN_COLUMNS_SAME) {
+        integrate_column(desc, job);
+        jobs_by_kind[2]++;
+    } else {
+        integrate_full(desc, job);
+        jobs_by_kind[3]++;
+    }
+
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    total_vblanks += job->vblanks;
+    sceKernelSignalSema(acc_lock, 1);
+}
+
+static int exposure_thread(SceSize args, void *argp) {
+    (void)args;
+    (void)argp;
+
+    uint64_t next_save = SAVE_INTERVAL_VBLANKS;
+    while (1) {
+        sceKernelWaitSema(queue_items, 1, NULL);
+        sceKernelWaitSema(queue_lock, 1, NULL);
+        if (queue_count == 0) {
+            // Only the wake-up from exposure_term() arrives with nothing queued
+            sceKernelSignalSema(queue_lock, 1);
+            if (__atomic_load_n(&quitting, __ATOMIC_ACQUIRE)) break;
+            continue;
+        }
+        ExposureJob job = queue[queue_head];
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count--;
+        sceKernelSignalSema(queue_lock, 1);
+
+        integrate(&job);
+        // Only this thread adds to total_vblanks
+        if (total_vblanks >= next_save) {
+            next_save = total_vblanks + SAVE_INTERVAL_VBLANKS;
+            if (exposure_save() < 0) evlog_printf("exposure: could not write exposure.bin");
+        }
+    }
+    return 0;
+}
+
+static int push(const ExposureJob *job) {
+    int pushed = 0;
+    sceKernelWaitSema(queue_lock, 1, NULL);
+    if (queue_count < QUEUE_SIZE) {
+        queue[(queue_head + queue_count) % QUEUE_SIZE] = *job;
+        queue_count++;
+        pushed = 1;
+    }
+    sceKernelSignalSema(queue_lock, 1);
+    if (pushed) sceKernelSignalSema(queue_items, 1);
+    return pushed;
+}
+
+int exposure_init(void) {
+    scratch = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    acc_lock = sceKernelCreateSema("exposure_acc", 0, 1, 1, NULL);
+    queue_lock = sceKernelCreateSema("exposure_queue", 0, 1, 1, NULL);
+    // One count above the queue size for the wake-up from exposure_term()
+    queue_items = sceKernelCreateSema("exposure_items", 0, 0, QUEUE_SIZE + 1, NULL);
+    save_lock = sceKernelCreateSema("exposure_save", 0, 1, 1, NULL);
+
+    // Low priority on the third user core: integration may lag, never the display
+    worker = sceKernelCreateThread("exposure", exposure_thread,
+                                   SCE_KERNEL_LOWEST_PRIORITY_USER, 0x4000, 0,
+                                   SCE_KERNEL_CPU_MASK_USER_2, NULL);
+    if (!scratch || acc_lock < 0 || queue_lock < 0 || queue_items < 0 || save_lock < 0 || worker < 0) {
+        evlog_printf("exposure: not available");
+        free(scratch);
+        scratch = NULL;
+        worker = -1;
+        return -1;
+    }
+    sceKernelStartThread(worker, 0, NULL);
+    return 0;
+}
+
+// Hand the state on screen so far to the worker
+static void finish_current(void) {
+    if (!current_valid) return;
+    int vcount = sceDisplayGetVcount();
+    // The vcount wraps at 16 bits; dwells are sliced well below that
+    current.vblanks = (uint16_t)(vcount - current_vcount);
+    current_vcount = vcount;
+    if (current.vblanks == 0) return;
+    if (push(&current)) {
+        queued_vblanks += current.vblanks;
+    } else {
+        dropped_vblanks += current.vblanks;
+    }
+}
+
+void exposure_frame(int pattern, const PatternArgs *args, int state) {
+    if (worker < 0) return;
+
+    int same = current_valid && current.pattern == pattern && current.state == state &&
+               memcmp(&current.args, args, sizeof(*args)) == 0;
+    if (same) {
+        if ((uint16_t)(sceDisplayGetVcount() - current_vcount) < MAX_DWELL_VBLANKS) return;
+        finish_current();
+        return;
+    }
+
+    finish_current();
+    current.pattern = pattern;
+    current.args = *args;
+    current.state = state;
+    current_vcount = sceDisplayGetVcount();
+    current_valid = 1;
+}
+
+void exposure_idle(void) {
+    if (worker < 0) return;
+    finish_current();
+    current_valid = 0;
+}
+
+uint64_t exposure_vblanks(void) {
+    if (acc_lock < 0) return 0;
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    uint64_t vblanks = total_vblanks;
+    sceKernelSignalSema(acc_lock, 1);
+    return vblanks;
+}
+
+// Total of tile (tx, ty) in channel c; caller holds acc_lock
+static uint64_t tile_total(int tx, int ty, int c) {
+    return tiles[ty][tx][c] +
+           (columns[tx][c] + rows[ty][c]) * EXPOSURE_TILE +
+           uniform[c] * (EXPOSURE_TILE * EXPOSURE_TILE);
+}
+
+int exposure_save(void) {
+    static uint64_t resolved[EXPOSURE_TILES_Y][EXPOSURE_TILES_X][3];
+    ExposureFileHeader header = {
+        .magic = EXPOSURE_FILE_MAGIC,
+        .version = EXPOSURE_FILE_VERSION,
+        .tile_size = EXPOSURE_TILE,
+        .tiles_x = EXPOSURE_TILES_X,
+        .tiles_y = EXPOSURE_TILES_Y,
+    };
+
+    sceKernelWaitSema(save_lock, 1, NULL);
+    sceKernelWaitSema(acc_lock, 1, NULL);
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+            for (int c = 0; c < 3; c++) {
+                resolved[ty][tx][c] = tile_total(tx, ty, c);
+            }
+        }
+    }
+    header.vblanks = total_vblanks;
+    sceKernelSignalSema(acc_lock, 1);
+
+    char path[128];
+    storage_path(path, sizeof(path), "exposure.bin");
+    SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    int ok = fd >= 0 &&
+             sceIoWrite(fd, &header, sizeof(header)) == (int)sizeof(header) &&
+             sceIoWrite(fd, resolved, sizeof(resolved)) == (int)sizeof(resolved);
+    if (fd >= 0) sceIoClose(fd);
+    sceKernelSignalSema(save_lock, 1);
+    return ok ? 0 : -1;
+}
+
+int exposure_checkpoint(void) {
+    if (worker < 0) return 0;
+    exposure_idle();
+    for (int waited = 0; exposure_vblanks() < queued_vblanks && waited < CHECKPOINT_WAIT_US; waited += 1000) {
+        sceKernelDelayThread(1000);
+    }
+    return exposure_save();
+}
+
+void exposure_term(void) {
+    if (worker < 0) return;
+    exposure_idle();
+
+    // The worker drains the queue before it sees the flag
+    __atomic_store_n(&quitting, 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(queue_items, 1);
+    sceKernelWaitThreadEnd(worker, NULL, NULL);
+    sceKernelDeleteThread(worker);
+    worker = -1;
+
+    evlog_printf("exposure: %llu vblanks integrated (%u solid, %u row, %u column, %u full jobs), %llu dropped",
+                 (unsigned long long)total_vblanks, (unsigned)jobs_by_kind[0], (unsigned)jobs_by_kind[1],
+                 (unsigned)jobs_by_kind[2], (unsigned)jobs_by_kind[3], (unsigned long long)dropped_vblanks);
+    if (exposure_save() < 0) {
+        evlog_printf("exposure: could not write exposure.bin");
+    }
+
+    free(scratch);
+    scratch = NULL;
+    sceKernelDeleteSema(queue_items);
+    sceKernelDeleteSema(queue_lock);
+    sceKernelDeleteSema(acc_lock);
+    sceKernelDeleteSema(save_lock);
+    queue_items = queue_lock = acc_lock = save_lock = -1;
+}
+
+// ============================================
+// False-color view
+// ============================================
+
+static const uint8_t heat_stops[][3] = {
+    {0, 0, 0}, {0, 0, 255}, {0, 255, 255}, {0, 255, 0},
+    {255, 255, 0}, {255, 0, 0}, {255, 255, 255}
+};
+
+#define HEAT_STOPS ((int)(sizeof(heat_stops) / sizeof(heat_stops[0])))
+
+static uint32_t heat_color(int level) {
+    static uint32_t lut[256];
+    static int lut_ready = 0;
+    if (!lut_ready) {
+        for (int i = 0; i < 256; i++) {
+            int pos = i * (HEAT_STOPS - 1);
+            int s = pos / 255;
+            int f = pos % 255;
+            int n = (s < HEAT_STOPS - 1) ? s + 1 : s;
+            uint8_t c[3];
+            for (int k = 0; k < 3; k++) {
+                c[k] = (uint8_t)((heat_stops[s][k] * (255 - f) + heat_stops[n][k] * f) / 255);
+            }
+            lut[i] = make_color_bgr(c[0], c[1], c[2]);
+        }
+        lut_ready = 1;
+    }
+    return lut[level];
+}
+
+void exposure_draw_heatmap(uint32_t *pixels) {
+    static uint64_t sums[EXPOSURE_TILES_Y][EXPOSURE_TILES_X];
+    uint64_t peak = 0;
+    uint64_t vblanks = 0;
+
+    if (acc_lock >= 0) {
+        sceKernelWaitSema(acc_lock, 1, NULL);
+        for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+            for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+                uint64_t sum = tile_total(tx, ty, 0) + tile_total(tx, ty, 1) + tile_total(tx, ty, 2);
+                sums[ty][tx] = sum;
+                if (sum > peak) peak = sum;
+            }
+        }
+        vblanks = total_vblanks;
+        sceKernelSignalSema(acc_lock, 1);
+    } else {
+        memset(sums, 0, sizeof(sums));
+    }
+
+    // Normalized to the brightest tile
+    for (int ty = 0; ty < EXPOSURE_TILES_Y; ty++) {
+        for (int tx = 0; tx < EXPOSURE_TILES_X; tx++) {
+            int level = peak ? (int)(sums[ty][tx] * 255 / peak) : 0;
+            uint32_t color = heat_color(level);
+            uint32_t *dst = pixels + ty * EXPOSURE_TILE * SCREEN_FB_WIDTH + tx * EXPOSURE_TILE;
+            for (int y = 0; y < EXPOSURE_TILE; y++) {
+                fill_span(dst + y * SCREEN_FB_WIDTH, color, EXPOSURE_TILE);
+            }
+        }
+    }
+
+    // Legend: color scale and the peak as an average level per subpixel
+    int legend_x = SCREEN_WIDTH - 8 - 256;
+    int legend_y = SCREEN_HEIGHT - 40;
+    draw_box(pixels, legend_x - 8, legend_y - 8, 256 + 16, 40, COLOR_BLACK, COLOR_DARK_GRAY);
+    for (int i = 0; i < 256; i++) {
+        for (int y = 0; y < 8; y++) {
+            pixels[(legend_y + y) * SCREEN_FB_WIDTH + legend_x + i] = heat_color(i);
+        }
+    }
+
+    char line[64];
+    unsigned peak_level = vblanks ? (unsigned)(peak / (vblanks * 3 * EXPOSURE_TILE * EXPOSURE_TILE)) : 0;
+    snprintf(line, sizeof(line), "EXPOSURE %u s  PEAK AVG %u", (unsigned)(vblanks * 1001 / 60000),
+             peak_level);
+    draw_string(pixels, legend_x, legend_y + 14, line, 1, COLOR_WHITE, 0, 0);
+}
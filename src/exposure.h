@@ -0,0 +1,68 @@
+#ifndef EXPOSURE_H
+#define EXPOSURE_H
+
+#include <stdint.h>
+#include "display.h"
+#include "patterns.h"
+
+// Exposure accumulation.
+//
+// Keeps a running total of the light every subpixel has emitted during
+// the session, downsampled to EXPOSURE_TILE x EXPOSURE_TILE tiles. The main
+// thread only reports which pattern state each frame shows; a worker
+// thread integrates every state once for as many vblanks as it stayed on
+// screen, and uses the pattern flags to avoid rasterizing where it can:
+//   - solid patterns add their color to a screen-wide term,
+//   - patterns with identical rows (columns) add a column (row) profile
+//     taken from one rasterized row (column),
+//   - anything else is rasterized into a scratch frame and reduced.
+// Overlays drawn on top of patterns are not counted.
+//
+// Totals are in code value x pixel x vblank units per channel.
+
+#define EXPOSURE_TILE    8
+#define EXPOSURE_TILES_X (SCREEN_WIDTH / EXPOSURE_TILE)
+#define EXPOSURE_TILES_Y (SCREEN_HEIGHT / EXPOSURE_TILE)
+
+#define EXPOSURE_FILE_MAGIC   0x4F505845   // "EXPO"
+#define EXPOSURE_FILE_VERSION 1
+
+// exposure.bin: this header, then uint64 totals [tiles_y][tiles_x][3] in R, G, B order
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tile_size;
+    uint16_t tiles_x;
+    uint16_t tiles_y;
+    uint32_t reserved;
+    uint64_t vblanks;
+} ExposureFileHeader;
+
+// Start the worker thread; returns < 0 if exposure cannot be tracked
+int exposure_init(void);
+
+// Integrate everything still pending, stop the worker and save the map
+void exposure_term(void);
+
+// Report the pattern state of the frame about to be flipped
+void exposure_frame(int pattern, const PatternArgs *args, int state);
+
+// Report that the next frames are not a pattern (nothing is counted)
+void exposure_idle(void);
+
+// Vblanks integrated so far
+uint64_t exposure_vblanks(void);
+
+// Write APP_DATA_DIR/exposure.bin; returns 0 on success. The worker also
+// saves on its own every few minutes of integrated vblanks.
+int exposure_save(void);
+
+// Close the state on screen, give the worker a moment to integrate what
+// is queued and save; for when the process may not get to exposure_term().
+// Returns < 0 if the map could not be written.
+int exposure_checkpoint(void);
+
+// Draw the map as a false-color view over the whole screen
+void exposure_draw_heatmap(uint32_t *pixels);
+
+#endif
@@ -0,0 +1,176 @@
+#include "font.h"
+#include "display.h"
+
+// ============================================
+// Font rendering system (4x6 tiny font)
+// ============================================
+
+// 4x6 font for characters (compact)
+static const uint8_t font_4x6[96][6] = {
+    {0x0,0x0,0x0,0x0,0x0,0x0}, // space
+    {0x4,0x4,0x4,0x0,0x4,0x0}, // !
+    {0xA,0xA,0x0,0x0,0x0,0x0}, // "
+    {0xA,0xF,0xA,0xF,0xA,0x0}, // #
+    {0x4,0xE,0xC,0x2,0xE,0x4}, // $
+    {0x9,0x2,0x4,0x8,0x9,0x0}, // %
+    {0x4,0xA,0x4,0xA,0x5,0x0}, // &
+    {0x4,0x4,0x0,0x0,0x0,0x0}, // '
+    {0x2,0x4,0x4,0x4,0x2,0x0}, // (
+    {0x4,0x2,0x2,0x2,0x4,0x0}, // )
+    {0x0,0xA,0x4,0xA,0x0,0x0}, // *
+    {0x0,0x4,0xE,0x4,0x0,0x0}, // +
+    {0x0,0x0,0x0,0x4,0x4,0x8}, // ,
+    {0x0,0x0,0xE,0x0,0x0,0x0}, // -
+    {0x0,0x0,0x0,0x0,0x4,0x0}, // .
+    {0x1,0x2,0x4,0x8,0x0,0x0}, // /
+    {0x6,0x9,0x9,0x9,0x6,0x0}, // 0
+    {0x4,0xC,0x4,0x4,0xE,0x0}, // 1
+    {0x6,0x9,0x2,0x4,0xF,0x0}, // 2
+    {0xE,0x1,0x6,0x1,0xE,0x0}, // 3
+    {0x2,0x6,0xA,0xF,0x2,0x0}, // 4
+    {0xF,0x8,0xE,0x1,0xE,0x0}, // 5
+    {0x6,0x8,0xE,0x9,0x6,0x0}, // 6
+    {0xF,0x1,0x2,0x4,0x4,0x0}, // 7
+    {0x6,0x9,0x6,0x9,0x6,0x0}, // 8
+    {0x6,0x9,0x7,0x1,0x6,0x0}, // 9
+    {0x0,0x4,0x0,0x4,0x0,0x0}, // :
+    {0x0,0x4,0x0,0x4,0x4,0x8}, // ;
+    {0x2,0x4,0x8,0x4,0x2,0x0}, // <
+    {0x0,0xE,0x0,0xE,0x0,0x0}, // =
+    {0x8,0x4,0x2,0x4,0x8,0x0}, // >
+    {0x6,0x9,0x2,0x0,0x4,0x0}, // ?
+    {0x6,0x9,0xB,0x8,0x6,0x0}, // @
+    {0x6,0x9,0xF,0x9,0x9,0x0}, // A
+    {0xE,0x9,0xE,0x9,0xE,0x0}, // B
+    {0x6,0x9,0x8,0x9,0x6,0x0}, // C
+    {0xE,0x9,0x9,0x9,0xE,0x0}, // D
+    {0xF,0x8,0xE,0x8,0xF,0x0}, // E
+    {0xF,0x8,0xE,0x8,0x8,0x0}, // F
+    {0x6,0x8,0xB,0x9,0x6,0x0}, // G
+    {0x9,0x9,0xF,0x9,0x9,0x0}, // H
+    {0xE,0x4,0x4,0x4,0xE,0x0}, // I
+    {0x7,0x1,0x1,0x9,0x6,0x0}, // J
+    {0x9,0xA,0xC,0xA,0x9,0x0}, // K
+    {0x8,0x8,0x8,0x8,0xF,0x0}, // L
+    {0x9,0xF,0xF,0x9,0x9,0x0}, // M
+    {0x9,0xD,0xB,0x9,0x9,0x0}, // N
+    {0x6,0x9,0x9,0x9,0x6,0x0}, // O
+    {0xE,0x9,0xE,0x8,0x8,0x0}, // P
+    {0x6,0x9,0x9,0xA,0x5,0x0}, // Q
+    {0xE,0x9,0xE,0xA,0x9,0x0}, // R
+    {0x6,0x8,0x6,0x1,0xE,0x0}, // S
+    {0xE,0x4,0x4,0x4,0x4,0x0}, // T
+    {0x9,0x9,0x9,0x9,0x6,0x0}, // U
+    {0x9,0x9,0x9,0x6,0x6,0x0}, // V
+    {0x9,0x9,0xF,0xF,0x9,0x0}, // W
+    {0x9,0x9,0x6,0x9,0x9,0x0}, // X
+    {0x9,0x9,0x6,0x4,0x4,0x0}, // Y
+    {0xF,0x1,0x6,0x8,0xF,0x0}, // Z
+    {0x6,0x4,0x4,0x4,0x6,0x0}, // [
+    {0x8,0x4,0x2,0x1,0x0,0x0}, // backslash
+    {0x6,0x2,0x2,0x2,0x6,0x0}, // ]
+    {0x4,0xA,0x0,0x0,0x0,0x0}, // ^
+    {0x0,0x0,0x0,0x0,0xF,0x0}, // _
+    {0x4,0x2,0x0,0x0,0x0,0x0}, // `
+    {0x0,0x6,0x9,0xB,0x5,0x0}, // a
+    {0x8,0xE,0x9,0x9,0xE,0x0}, // b
+    {0x0,0x6,0x8,0x8,0x6,0x0}, // c
+    {0x1,0x7,0x9,0x9,0x7,0x0}, // d
+    {0x0,0x6,0xF,0x8,0x6,0x0}, // e
+    {0x2,0x4,0xE,0x4,0x4,0x0}, // f
+    {0x0,0x7,0x9,0x7,0x1,0x6}, // g
+    {0x8,0xE,0x9,0x9,0x9,0x0}, // h
+    {0x4,0x0,0x4,0x4,0x4,0x0}, // i
+    {0x2,0x0,0x2,0x2,0xA,0x4}, // j
+    {0x8,0x9,0xA,0xC,0x9,0x0}, // k
+    {0x4,0x4,0x4,0x4,0x2,0x0}, // l
+    {0x0,0xA,0xF,0x9,0x9,0x0}, // m
+    {0x0,0xE,0x9,0x9,0x9,0x0}, // n
+    {0x0,0x6,0x9,0x9,0x6,0x0}, // o
+    {0x0,0xE,0x9,0xE,0x8,0x8}, // p
+    {0x0,0x7,0x9,0x7,0x1,0x1}, // q
+    {0x0,0x6,0x9,0x8,0x8,0x0}, // r
+    {0x0,0x7,0xC,0x3,0xE,0x0}, // s
+    {0x4,0xE,0x4,0x4,0x2,0x0}, // t
+    {0x0,0x9,0x9,0x9,0x6,0x0}, // u
+    {0x0,0x9,0x9,0x6,0x6,0x0}, // v
+    {0x0,0x9,0x9,0xF,0x6,0x0}, // w
+    {0x0,0x9,0x6,0x6,0x9,0x0}, // x
+    {0x0,0x9,0x9,0x7,0x1,0x6}, // y
+    {0x0,0xF,0x2,0x4,0xF,0x0}, // z
+    {0x2,0x4,0xC,0x4,0x2,0x0}, // {
+    {0x4,0x4,0x4,0x4,0x4,0x0}, // |
+    {0x8,0x4,0x6,0x4,0x8,0x0}, // }
+    {0x0,0x5,0xA,0x0,0x0,0x0}, // ~
+    {0xF,0xF,0xF,0xF,0xF,0xF}, // DEL (filled block)
+};
+
+const uint8_t *font_glyph(char c) {
+    int idx = c - 32;
+    if (idx < 0 || idx >= 96) idx = 0;
+    return font_4x6[idx];
+}
+
+void draw_char(uint32_t *pixels, int x, int y, char c, int scale, uint32_t fg, uint32_t bg, int use_bg) {
+    const uint8_t *glyph = font_glyph(c);
+    
+    for (int row = 0; row < 6; row++) {
+        uint8_t line = glyph[row];
+        for (int col = 0; col < 4; col++) {
+            int set = (line >> (3 - col)) & 1;
+            if (set || use_bg) {
+                uint32_t color = set ? fg : bg;
+                for (int sy = 0; sy < scale; sy++) {
+                    for (int sx = 0; sx < scale; sx++) {
+                        int px = x + col * scale + sx;
+                        int py = y + row * scale + sy;
+                        if (px >= 0 && px < SCREEN_WIDTH && py >= 0 && py < SCREEN_HEIGHT) {
+                            pixels[py * SCREEN_FB_WIDTH + px] = color;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void draw_string(uint32_t *pixels, int x, int y, const char *str, int scale, uint32_t fg, uint32_t bg, int use_bg) {
+    int orig_x = x;
+    while (*str) {
+        if (*str == '\n') {
+            y += 6 * scale + scale;
+            x = orig_x;
+        } else {
+            draw_char(pixels, x, y, *str, scale, fg, bg, use_bg);
+            x += 4 * scale + scale;
+        }
+        str++;
+    }
+}
+
+int get_string_width(const char *str, int scale) {
+    int width = 0;
+    int max_width = 0;
+    while (*str) {
+        if (*str == '\n') {
+            if (width > max_width) max_width = width;
+            width = 0;
+        } else {
+            width += 4 * scale + scale;
+        }
+        str++;
+    }
+    return (width > max_width) ? width : max_width;
+}
+
+// Draw a box with outline
+void draw_box(uint32_t *pixels, int x, int y, int w, int h, uint32_t fill, uint32_t outline) {
+    for (int py = y; py < y + h && py < SCREEN_HEIGHT; py++) {
+        for (int px = x; px < x + w && px < SCREEN_WIDTH; px++) {
+            if (px >= 0 && py >= 0) {
+                int is_border = (px == x || px == x + w - 1 || py == y || py == y + h - 1);
+                pixels[py * SCREEN_FB_WIDTH + px] = is_border ? outline : fill;
+            }
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// 4x6 bitmap font and simple boxes, drawn straight into a framebuffer
+// with SCREEN_FB_WIDTH pitch. Everything is clipped to the screen.
+
+void draw_char(uint32_t *pixels, int x, int y, char c, int scale, uint32_t fg, uint32_t bg, int use_bg);
+void draw_string(uint32_t *pixels, int x, int y, const char *str, int scale, uint32_t fg, uint32_t bg, int use_bg);
+int get_string_width(const char *str, int scale);
+
+// Rows of the glyph draw_char uses for c, bit 3 leftmost
+const uint8_t *font_glyph(char c);
+
+// Draw a box with outline
+void draw_box(uint32_t *pixels, int x, int y, int w, int h, uint32_t fill, uint32_t outline);
+
+#endif
@@ -0,0 +1,129 @@
+#include "frame_cache.h"
+#include "span.h"
+
+#include <psp2/kernel/sysmem.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t key;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t sequence;
+    uint64_t checksum;
+    int valid;
+} CacheEntry;
+
+static SceUID arena_block = -1;
+static uint8_t *arena = NULL;
+static uint8_t *staging = NULL;
+static uint32_t head = 0;
+static uint32_t next_sequence = 0;
+static CacheEntry entries[FRAME_CACHE_MAX_ENTRIES];
+
+int frame_cache_init(void) {
+    arena_block = sceKernelAllocMemBlock("frame_cache", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW,
+                                         FRAME_CACHE_ARENA_SIZE + FRAME_CACHE_STAGING_SIZE, NULL);
+    if (arena_block < 0) return -1;
+
+    void *base;
+    sceKernelGetMemBlockBase(arena_block, &base);
+    arena = (uint8_t *)base;
+    staging = arena + FRAME_CACHE_ARENA_SIZE;
+    head = 0;
+    memset(entries, 0, sizeof(entries));
+    return 0;
+}
+
+void frame_cache_term(void) {
+    if (arena_block >= 0) {
+        sceKernelFreeMemBlock(arena_block);
+    }
+    arena_block = -1;
+    arena = NULL;
+    staging = NULL;
+}
+
+const RleFrame *frame_cache_find(uint32_t key) {
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].valid && entries[i].key == key) {
+            return (const RleFrame *)(arena + entries[i].offset);
+        }
+    }
+    return NULL;
+}
+
+static CacheEntry *claim_slot(uint32_t key) {
+    CacheEntry *oldest = &entries[0];
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].valid && entries[i].key == key) return &entries[i];
+    }
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        if (!entries[i].valid) return &entries[i];
+        if (entries[i].sequence < oldest->sequence) oldest = &entries[i];
+    }
+    return oldest;
+}
+
+static uint64_t blob_checksum(const uint8_t *blob, uint32_t size) {
+    uint32_t sum[2] = {0, 0};
+    checksum_span((const uint32_t *)blob, (int)(size / 4), sum);
+    return checksum_value(sum);
+}
+
+const RleFrame *frame_cache_store(uint32_t key, const uint32_t *src, int width, int height, int pitch) {
+    if (!arena) return NULL;
+
+    // Leave room to pad the blob to 8 bytes
+    size_t size = rle_encode(src, width, height, pitch, staging, FRAME_CACHE_STAGING_SIZE - 8);
+    if (size == 0) return NULL;
+    size_t padded = (size + 7) & ~(size_t)7;
+    memset(staging + size, 0, padded - size);
+    size = padded;
+
+    if (head + size > FRAME_CACHE_ARENA_SIZE) head = 0;
+
+    // Evict everything the new blob overlaps
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        CacheEntry *e = &entries[i];
+        if (e->valid && e->offset < head + size && head < e->offset + e->size) {
+            e->valid = 0;
+        }
+    }
+
+    CacheEntry *slot = claim_slot(key);
+    memcpy(arena + head, staging, size);
+    slot->key = key;
+    slot->offset = head;
+    slot->size = (uint32_t)size;
+    slot->sequence = next_sequence++;
+    slot->checksum = blob_checksum(staging, slot->size);
+    slot->valid = 1;
+
+    head += size;
+    return (const RleFrame *)(arena + slot->offset);
+}
+
+int frame_cache_verify(void) {
+    int dropped = 0;
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        CacheEntry *e = &entries[i];
+        if (e->valid && blob_checksum(arena + e->offset, e->size) != e->checksum) {
+            e->valid = 0;
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+void frame_cache_stats(int *count, uint32_t *bytes) {
+    int n = 0;
+    uint32_t total = 0;
+    for (int i = 0; i < FRAME_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].valid) {
+            n++;
+            total += entries[i].size;
+        }
+    }
+    if (count) *count = n;
+    if (bytes) *bytes = total;
+}
@@ -0,0 +1,39 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <stdint.h>
+#include "rle.h"
+
+// Compressed frame cache.
+//
+// Rendered frames are stored as RLE blobs in a fixed LPDDR arena (not
+// CDRAM) and expanded into the back buffer on demand. Space is handed out
+// as a ring, so when the arena is full the oldest frames are evicted first.
+// Each blob keeps a checksum so its contents can be re-validated after the
+// memory may have been disturbed (e.g. a system suspend).
+//
+// The cache has a single owner at a time: the startup thread fills it
+// before startup is ready, the main thread uses it afterwards.
+
+#define FRAME_CACHE_ARENA_SIZE   (1024 * 1024)
+#define FRAME_CACHE_STAGING_SIZE (256 * 1024)
+#define FRAME_CACHE_MAX_ENTRIES  64
+
+// Key for a pattern in a given state (0 for static patterns)
+#define FRAME_CACHE_KEY(pattern, variant) (((uint32_t)(pattern) << 16) | ((uint32_t)(variant) & 0xFFFF))
+
+int frame_cache_init(void);
+void frame_cache_term(void);
+
+const RleFrame *frame_cache_find(uint32_t key);
+
+// Compress and store a rendered frame; returns NULL if it does not fit
+const RleFrame *frame_cache_store(uint32_t key, const uint32_t *src, int width, int height, int pitch);
+
+// Check every stored frame against the checksum taken when it was stored
+// and drop the ones that no longer match; returns the number dropped
+int frame_cache_verify(void);
+
+void frame_cache_stats(int *entries, uint32_t *bytes);
+
+#endif
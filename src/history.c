@@ -0,0 +1,536 @@
+#include "history.h"
+#include "compositor.h"
+#include "evlog.h"
+#include "rle.h"
+#include "span.h"
+#include "storage.h"
+
+#include <psp2/display.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STAGING_SIZE (512 * 1024)
+#define MAX_RECTS    LAYER_COUNT  // Overlay areas per frame, one per compositor layer
+#define MAX_DUMPS    1000         // history_000 to history_999
+
+// Every this many frames all overlay areas are stored in full, so losing
+// a chunk only spoils the overlays until the next keyframe
+#define KEYFRAME_INTERVAL 60
+
+#define ENTRY_KEYFRAME (1 << 0)   // Every rect was stored in full
+#define ENTRY_LOST     (1 << 1)   // Some pixels did not fit or were evicted
+
+typedef enum { KIND_PATTERN, KIND_VIEW } FrameKind;
+
+// Overlays use a handful of colors, so bands are normally stored as
+// 16-bit runs (4-bit palette index, 12-bit length), a quarter of the size
+// of RleRuns; bands with more colors fall back to RLE
+#define PALETTE_SIZE   16
+#define PALETTE_MAX_RUN 4096
+
+typedef enum { CODEC_PALETTE, CODEC_RLE } PartCodec;
+
+// A chunk holds the rows of a frame's rects that changed since the
+// previous frame, as bands: ChunkPart followed by the encoded band. A
+// palette band is uint32_t palette[PALETTE_SIZE] and then the runs of
+// every row in order.
+typedef struct {
+    Rect rect;
+    uint32_t size;          // Bytes that follow, multiple of 8
+    uint16_t codec;
+    uint16_t reserved;
+} ChunkPart;
+
+typedef struct {
+    uint32_t frame;
+    uint32_t vcount;        // Vblank count at the flip (wraps at 16 bits)
+    uint64_t time;
+    uint8_t kind;
+    uint8_t flags;
+    uint8_t rect_count;
+    uint8_t part_count;
+    int16_t pattern;
+    int32_t state;
+    PatternArgs args;
+    Rect rects[MAX_RECTS];  // Overlays (or the whole view) in drawing order
+    uint32_t chunk_seq;     // 0 if no pixels are held
+    uint32_t chunk_offset;
+    uint32_t chunk_size;
+} HistoryEntry;
+
+static SceUID arena_block = -1;
+static uint8_t *arena = NULL;
+static uint8_t *staging = NULL;
+static uint32_t head = 0;
+static uint32_t next_chunk_seq = 1;
+
+// Main thread: the ring and the frame being recorded
+static HistoryEntry entries[HISTORY_FRAMES];
+static uint32_t frame_count = 0;
+static HistoryEntry pending;
+static uint32_t staging_used = 0;
+static int recording = 0;
+static int frames_since_key = 0;
+
+// Rects of the last recorded frame and the checksums of their rows
+static Rect prev_rects[MAX_RECTS];
+static int prev_rect_count = 0;
+static uint64_t row_sums[MAX_RECTS][SCREEN_HEIGHT];
+
+// Dump snapshot, owned by the worker while dump_active is set
+static HistoryEntry dump_entries[HISTORY_FRAMES];
+static uint32_t dump_count = 0;
+static uint32_t dump_end_vcount = 0;
+static uint64_t dump_end_time = 0;
+static uint32_t dump_done_seq = 0;   // Chunks below this are no longer needed
+static int dump_active = 0;
+
+static SceUID dump_request = -1;
+static SceUID worker = -1;
+static int quitting = 0;
+
+static const Rect full_screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+// ============================================
+// Recording (main thread)
+// ============================================
+
+static uint64_t row_checksum(const uint32_t *row, int count) {
+    uint32_t sum[2] = {0, 0};
+    checksum_span(row, count, sum);
+    return checksum_value(sum);
+}
+
+// Returns the encoded size, or 0 if the band has too many colors or does
+// not fit in capacity bytes
+static size_t palette_encode(const uint32_t *src, int width, int height, uint8_t *out, size_t capacity) {
+    if (capacity < PALETTE_SIZE * sizeof(uint32_t)) return 0;
+    uint32_t *palette = (uint32_t *)out;
+    uint16_t *runs = (uint16_t *)(palette + PALETTE_SIZE);
+    size_t max_runs = (capacity - PALETTE_SIZE * sizeof(uint32_t)) / sizeof(uint16_t);
+    size_t count = 0;
+    int colors = 0;
+    int last = 0;
+    memset(palette, 0, PALETTE_SIZE * sizeof(uint32_t));
+
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = src + y * SCREEN_FB_WIDTH;
+        for (int x = 0; x < width;) {
+            uint32_t color = row[x];
+            int length = 1;
+            while (x + length < width && row[x + length] == color && length < PALETTE_MAX_RUN) length++;
+            x += length;
+
+            if (palette[last] != color || last >= colors) {
+                last = 0;
+                while (last < colors && palette[last] != color) last++;
+                if (last == colors) {
+                    if (colors == PALETTE_SIZE) return 0;
+                    palette[colors++] = color;
+                }
+            }
+            if (count == max_runs) return 0;
+            runs[count++] = (uint16_t)((last << 12) | (length - 1));
+        }
+    }
+    return PALETTE_SIZE * sizeof(uint32_t) + count * sizeof(uint16_t);
+}
+
+static void palette_decode(const ChunkPart *part, uint32_t *dst) {
+    const uint32_t *palette = (const uint32_t *)(part + 1);
+    const uint16_t *runs = (const uint16_t *)(palette + PALETTE_SIZE);
+    int width = part->rect.x1 - part->rect.x0;
+    for (int y = part->rect.y0; y < part->rect.y1; y++) {
+        uint32_t *row = dst + y * SCREEN_FB_WIDTH + part->rect.x0;
+        for (int x = 0; x < width; runs++) {
+            int length = (*runs & 0xFFF) + 1;
+            fill_span(row + x, palette[*runs >> 12], length);
+            x += length;
+        }
+    }
+}
+
+// Compress a band of pixels onto the staging chunk
+static int add_part(const uint32_t *pixels, const Rect *r) {
+    if (pending.part_count == UINT8_MAX || staging_used + sizeof(ChunkPart) + 8 > STAGING_SIZE) {
+        return 0;
+    }
+    // Keep 8 bytes of the room for padding the blob
+    ChunkPart *part = (ChunkPart *)(staging + staging_used);
+    uint32_t room = STAGING_SIZE - staging_used - sizeof(ChunkPart) - 8;
+    const uint32_t *src = pixels + r->y0 * SCREEN_FB_WIDTH + r->x0;
+    int width = r->x1 - r->x0;
+    int height = r->y1 - r->y0;
+    part->codec = CODEC_PALETTE;
+    size_t size = palette_encode(src, width, height, (uint8_t *)(part + 1), room);
+    if (size == 0) {
+        part->codec = CODEC_RLE;
+        size = rle_encode(src, width, height, SCREEN_FB_WIDTH, part + 1, room);
+    }
+    if (size == 0) return 0;
+    size = (size + 7) & ~(size_t)7;
+    part->rect = *r;
+    part->size = (uint32_t)size;
+    part->reserved = 0;
+    staging_used += sizeof(ChunkPart) + (uint32_t)size;
+    pending.part_count++;
+    return 1;
+}
+
+static int same_rect(const Rect *a, const Rect *b) {
+    return a->x0 == b->x0 && a->y0 == b->y0 && a->x1 == b->x1 && a->y1 == b->y1;
+}
+
+// Record rect r of pixels, storing only the rows that differ from what the
+// same slot held in the previous frame
+static void add_rect(const uint32_t *pixels, const Rect *r) {
+    int slot = pending.rect_count;
+    if (slot >= MAX_RECTS || r->x1 <= r->x0 || r->y1 <= r->y0) {
+        pending.flags |= ENTRY_LOST;
+        return;
+    }
+    pending.rects[slot] = *r;
+    pending.rect_count++;
+
+    int full = frames_since_key == 0 || slot >= prev_rect_count || !same_rect(r, &prev_rects[slot]);
+    int width = r->x1 - r->x0;
+    int band_start = -1;
+    for (int y = r->y0; y <= r->y1; y++) {
+        int changed = 0;
+        if (y < r->y1) {
+            uint64_t sum = row_checksum(pixels + y * SCREEN_FB_WIDTH + r->x0, width);
+            changed = full || sum != row_sums[slot][y - r->y0];
+            row_sums[slot][y - r->y0] = sum;
+        }
+        if (changed && band_start < 0) band_start = y;
+        if (!changed && band_start >= 0) {
+            Rect band = {r->x0, band_start, r->x1, y};
+            if (!add_part(pixels, &band)) pending.flags |= ENTRY_LOST;
+            band_start = -1;
+        }
+    }
+    if (!full) pending.flags &= ~ENTRY_KEYFRAME;
+}
+
+static void begin_frame(FrameKind kind) {
+    memset(&pending, 0, sizeof(pending));
+    pending.kind = kind;
+    pending.flags = ENTRY_KEYFRAME;
+    pending.pattern = -1;
+    staging_used = 0;
+    recording = 1;
+}
+
+void history_begin_pattern(int pattern, const PatternArgs *args, int state) {
+    if (!arena) return;
+    begin_frame(KIND_PATTERN);
+    pending.pattern = (int16_t)pattern;
+    pending.args = *args;
+    pending.state = state;
+}
+
+void history_begin_view(const uint32_t *pixels) {
+    if (!arena) return;
+    begin_frame(KIND_VIEW);
+    add_rect(pixels, &full_screen);
+}
+
+void history_overlay(const uint32_t *pixels, const Rect *r) {
+    if (!recording || pending.kind != KIND_PATTERN) return;
+    add_rect(pixels, r);
+}
+
+static int overlaps(const HistoryEntry *e, uint32_t at, uint32_t size) {
+    return e->chunk_seq != 0 && e->chunk_offset < at + size && at < e->chunk_offset + e->chunk_size;
+}
+
+// Move the staging chunk into the arena; returns 0 if there was no room
+// that a running dump does not still need
+static int store_chunk(void) {
+    uint32_t size = staging_used;
+    uint32_t at = head;
+    if (size > HISTORY_ARENA_SIZE) return 0;
+    if (at + size > HISTORY_ARENA_SIZE) at = 0;
+
+    // The snapshot, not the live ring, says what a running dump still
+    // reads: its oldest frames may have left the ring already
+    if (__atomic_load_n(&dump_active, __ATOMIC_ACQUIRE)) {
+        uint32_t done = __atomic_load_n(&dump_done_seq, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 0; i < dump_count; i++) {
+            const HistoryEntry *e = &dump_entries[i];
+            if (e->chunk_seq >= done && overlaps(e, at, size)) return 0;
+        }
+    }
+    for (int i = 0; i < HISTORY_FRAMES; i++) {
+        HistoryEntry *e = &entries[i];
+        if (overlaps(e, at, size)) {
+            e->chunk_seq = 0;
+            e->flags |= ENTRY_LOST;
+        }
+    }
+
+    memcpy(arena + at, staging, size);
+    pending.chunk_seq = next_chunk_seq++;
+    pending.chunk_offset = at;
+    pending.chunk_size = size;
+    head = at + size;
+    return 1;
+}
+
+void history_flipped(uint64_t time) {
+    if (!recording) return;
+    recording = 0;
+
+    pending.frame = frame_count;
+    pending.vcount = (uint32_t)sceDisplayGetVcount();
+    pending.time = time;
+    if (staging_used > 0 && !store_chunk()) {
+        pending.part_count = 0;
+        pending.flags |= ENTRY_LOST;
+    }
+    entries[frame_count % HISTORY_FRAMES] = pending;
+    frame_count++;
+
+    memcpy(prev_rects, pending.rects, sizeof(prev_rects));
+    prev_rect_count = pending.rect_count;
+    // Later deltas assume these rows were kept; start over if they were not
+    if (pending.flags & ENTRY_LOST) {
+        frames_since_key = 0;
+    } else if (++frames_since_key >= KEYFRAME_INTERVAL) {
+        frames_since_key = 0;
+    }
+}
+
+// ============================================
+// Dump (worker thread)
+// ============================================
+
+// Vblanks from a flip at (vcount, time) to one at (end_vcount, end_time).
+// The vcount wraps every 65536 vblanks (about 18 minutes), which a frame
+// held at a reduced refresh rate can outlast; the clock tells how many
+// whole wraps passed.
+static uint32_t vblanks_between(uint32_t vcount, uint64_t time, uint32_t end_vcount, uint64_t end_time) {
+    uint32_t wrapped = (uint16_t)(end_vcount - vcount);
+    int64_t estimate = end_time > time ? (int64_t)((end_time - time) / SCREEN_REFRESH_US) : 0;
+    int64_t wraps = (estimate - wrapped + 32768) / 65536;
+    return wrapped + (wraps > 0 ? (uint32_t)wraps * 65536 : 0);
+}
+
+// Apply a frame's changed bands to the overlay layer and compose the
+// frame into pixels; returns 0 if its overlays could not be restored
+static int reconstruct(const HistoryEntry *e, uint32_t *layer, int *layer_valid, uint32_t *pixels) {
+    if (e->flags & ENTRY_LOST) {
+        *layer_valid = 0;
+    } else {
+        const uint8_t *p = e->chunk_seq ? arena + e->chunk_offset : NULL;
+        for (int i = 0; p && i < e->part_count; i++) {
+            const ChunkPart *part = (const ChunkPart *)p;
+            if (part->codec == CODEC_PALETTE) {
+                palette_decode(part, layer);
+            } else {
+                rle_decode((const RleFrame *)(part + 1),
+                           layer + part->rect.y0 * SCREEN_FB_WIDTH + part->rect.x0, SCREEN_FB_WIDTH);
+            }
+            p += sizeof(ChunkPart) + part->size;
+        }
+        if (e->flags & ENTRY_KEYFRAME) *layer_valid = 1;
+    }
+
+    if (e->kind == KIND_PATTERN) {
+        pattern_render(pixels, &full_screen, pattern_get(e->pattern), &e->args, e->state);
+    } else {
+        fill_span(pixels, COLOR_BLACK, SCREEN_FB_WIDTH * SCREEN_HEIGHT);
+    }
+    if (e->rect_count == 0) return 1;
+    if (!*layer_valid) return 0;
+
+    for (int i = 0; i < e->rect_count; i++) {
+        const Rect *r = &e->rects[i];
+        for (int y = r->y0; y < r->y1; y++) {
+            memcpy(pixels + y * SCREEN_FB_WIDTH + r->x0, layer + y * SCREEN_FB_WIDTH + r->x0,
+                   (r->x1 - r->x0) * sizeof(uint32_t));
+        }
+    }
+    return 1;
+}
+
+static SceUID open_output(int *number, char *path, size_t size) {
+    for (int n = 0; n < MAX_DUMPS; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "history_%03d.bin", n);
+        storage_path(path, size, name);
+        SceUID probe = sceIoOpen(path, SCE_O_RDONLY, 0);
+        if (probe >= 0) {
+            sceIoClose(probe);
+            continue;
+        }
+        *number = n;
+        return sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    }
+    return -1;
+}
+
+static void write_dump(void) {
+    uint64_t start = sceKernelGetProcessTimeWide();
+    uint32_t *scratch = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    uint32_t *layer = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    uint8_t *encoded = malloc(SCREEN_FB_SIZE);
+    char path[128];
+    int number = 0;
+    SceUID bin = (scratch && layer && encoded) ? open_output(&number, path, sizeof(path)) : -1;
+    if (bin < 0) {
+        evlog_printf("history: could not start a dump");
+        free(scratch);
+        free(layer);
+        free(encoded);
+        return;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "history_%03d.csv", number);
+    storage_path(path, sizeof(path), name);
+    SceUID csv = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+
+    HistoryFileHeader header = {
+        .magic = HISTORY_FILE_MAGIC,
+        .version = HISTORY_FILE_VERSION,
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+        .frame_count = dump_count,
+    };
+    sceIoWrite(bin, &header, sizeof(header));
+    if (csv >= 0) {
+        const char *columns = "frame,time_us,vblanks,pattern,state,overlays,complete\n";
+        sceIoWrite(csv, columns, strlen(columns));
+    }
+
+    uint64_t previous = 0;
+    uint32_t bytes = sizeof(header);
+    int incomplete = 0;
+    int layer_valid = 0;
+    for (uint32_t i = 0; i < dump_count; i++) {
+        const HistoryEntry *e = &dump_entries[i];
+        int complete = reconstruct(e, layer, &layer_valid, scratch);
+        if (e->chunk_seq != 0) __atomic_store_n(&dump_done_seq, e->chunk_seq, __ATOMIC_RELEASE);
+
+        int last = i + 1 == dump_count;
+        uint32_t end = last ? dump_end_vcount : dump_entries[i + 1].vcount;
+        uint64_t end_time = last ? dump_end_time : dump_entries[i + 1].time;
+        HistoryRecord record = {
+            .frame = e->frame,
+            .vblanks = vblanks_between(e->vcount, e->time, end, end_time),
+            .time_us = e->time,
+        };
+        uint32_t sum[2] = {0, 0};
+        checksum_span(scratch, SCREEN_FB_WIDTH * SCREEN_HEIGHT, sum);
+        uint64_t checksum = checksum_value(sum);
+        size_t size = 0;
+        if (i == 0 || checksum != previous) {
+            size = rle_encode(scratch, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_FB_WIDTH,
+                              encoded, SCREEN_FB_SIZE);
+            if (size == 0) complete = 0;     // Too detailed to store; repeats the last frame
+        }
+        previous = checksum;
+        record.size = (uint32_t)size;
+        sceIoWrite(bin, &record, sizeof(record));
+        if (size) sceIoWrite(bin, encoded, (SceSize)size);
+        bytes += sizeof(record) + (uint32_t)size;
+        if (!complete) incomplete++;
+
+        if (csv >= 0) {
+            char line[128];
+            const char *pattern = e->kind == KIND_PATTERN ? pattern_get(e->pattern)->name : "(view)";
+            int len = snprintf(line, sizeof(line), "%u,%llu,%u,%s,%d,%d,%d\n",
+                               (unsigned)e->frame, (unsigned long long)e->time,
+                               (unsigned)record.vblanks, pattern, (int)e->state,
+                               e->kind == KIND_PATTERN ? e->rect_count : 0, complete);
+            sceIoWrite(csv, line, len);
+        }
+    }
+    sceIoClose(bin);
+    if (csv >= 0) sceIoClose(csv);
+    free(scratch);
+    free(layer);
+    free(encoded);
+
+    evlog_printf("history: wrote %u frames (%u incomplete) to history_%03d.bin, %u bytes in %u ms",
+                 (unsigned)dump_count, (unsigned)incomplete, number, (unsigned)bytes,
+                 (unsigned)((sceKernelGetProcessTimeWide() - start) / 1000));
+}
+
+static int history_thread(SceSize args, void *argp) {
+    (void)args; (void)argp;
+    for (;;) {
+        sceKernelWaitSema(dump_request, 1, NULL);
+        if (__atomic_load_n(&quitting, __ATOMIC_ACQUIRE)) break;
+        write_dump();
+        __atomic_store_n(&dump_active, 0, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+int history_dump(void) {
+    if (worker < 0 || frame_count == 0) return -1;
+    if (__atomic_load_n(&dump_active, __ATOMIC_ACQUIRE)) return -1;
+
+    // Oldest first; the recorder keeps running on the live ring
+    dump_count = frame_count < HISTORY_FRAMES ? frame_count : HISTORY_FRAMES;
+    uint32_t first = frame_count - dump_count;
+    for (uint32_t i = 0; i < dump_count; i++) {
+        dump_entries[i] = entries[(first + i) % HISTORY_FRAMES];
+    }
+    dump_end_vcount = (uint32_t)sceDisplayGetVcount();
+    dump_end_time = sceKernelGetProcessTimeWide();
+    dump_done_seq = 0;
+    __atomic_store_n(&dump_active, 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(dump_request, 1);
+    evlog_printf("history: dumping %u frames", (unsigned)dump_count);
+    return 0;
+}
+
+// ============================================
+// Setup
+// ============================================
+
+int history_init(void) {
+    arena_block = sceKernelAllocMemBlock("history", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW,
+                                         HISTORY_ARENA_SIZE + STAGING_SIZE, NULL);
+    // One request plus the wake-up from history_term()
+    dump_request = sceKernelCreateSema("history_dump", 0, 0, 2, NULL);
+    // Lowest priority on the third user core, like exposure integration
+    worker = sceKernelCreateThread("history", history_thread,
+                                   SCE_KERNEL_LOWEST_PRIORITY_USER, 0x4000, 0,
+                                   SCE_KERNEL_CPU_MASK_USER_2, NULL);
+    if (arena_block < 0 || dump_request < 0 || worker < 0) {
+        evlog_printf("history: not available");
+        if (arena_block >= 0) sceKernelFreeMemBlock(arena_block);
+        if (dump_request >= 0) sceKernelDeleteSema(dump_request);
+        arena_block = dump_request = worker = -1;
+        return -1;
+    }
+
+    void *base;
+    sceKernelGetMemBlockBase(arena_block, &base);
+    arena = (uint8_t *)base;
+    staging = arena + HISTORY_ARENA_SIZE;
+    sceKernelStartThread(worker, 0, NULL);
+    return 0;
+}
+
+void history_term(void) {
+    if (worker < 0) return;
+    // A running dump is finished before the worker sees the flag
+    __atomic_store_n(&quitting, 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(dump_request, 1);
+    sceKernelWaitThreadEnd(worker, NULL, NULL);
+    sceKernelDeleteThread(worker);
+    sceKernelDeleteSema(dump_request);
+    sceKernelFreeMemBlock(arena_block);
+    worker = dump_request = arena_block = -1;
+    arena = staging = NULL;
+    recording = 0;
+}
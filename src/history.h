@@ -0,0 +1,73 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include "display.h"
+#include "patterns.h"
+
+// Frame history recorder.
+//
+// Remembers the last HISTORY_FRAMES displayed frames (about ten seconds)
+// in fixed memory, so a glitch can be traced back to what was on screen
+// just before it. A pattern frame is kept as its registry id, arguments
+// and state plus the areas overlays were drawn over; any other view is
+// one area covering the screen. Of those areas only the rows that changed
+// since the previous frame are stored, palette or RLE coded, with every area
+// stored in full once a second. Pixels live in a ring arena and are
+// evicted oldest first; a frame whose overlay pixels cannot be restored
+// is still reconstructed from its pattern.
+//
+// history_dump() snapshots the ring and hands it to a low priority
+// worker, which reconstructs every frame and writes it out; the main
+// thread never waits for the card. Frames the dump still needs are not
+// overwritten while it runs (new frames lose their pixels instead).
+
+#define HISTORY_FRAMES     600
+#define HISTORY_ARENA_SIZE (2 * 1024 * 1024)
+
+#define HISTORY_FILE_MAGIC   0x48545356   // "VSTH"
+#define HISTORY_FILE_VERSION 1
+
+// history_NNN.bin: this header, then per frame a HistoryRecord followed by
+// `size` bytes of RleFrame (SCREEN_WIDTH x SCREEN_HEIGHT). Size 0 repeats
+// the previous frame's pixels. history_NNN.csv indexes the same frames.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint16_t width;
+    uint16_t height;
+    uint32_t frame_count;
+} HistoryFileHeader;
+
+typedef struct {
+    uint32_t frame;       // Displayed frame number
+    uint32_t vblanks;     // Vblanks the frame stayed on screen
+    uint64_t time_us;     // Process time of the flip
+    uint32_t size;        // Bytes of RleFrame that follow
+    uint32_t reserved;
+} HistoryRecord;
+
+// Allocate the ring and start the dump worker; returns < 0 if unavailable
+int history_init(void);
+
+// Stop the worker (finishing a running dump) and free the ring
+void history_term(void);
+
+// Start recording a frame that shows a registry pattern state
+void history_begin_pattern(int pattern, const PatternArgs *args, int state);
+
+// Start recording a frame that is not a pattern; pixels are kept as-is
+void history_begin_view(const uint32_t *pixels);
+
+// An opaque overlay was drawn over r in pixels
+void history_overlay(const uint32_t *pixels, const Rect *r);
+
+// The recorded frame was just flipped
+void history_flipped(uint64_t time);
+
+// Write the current history to APP_DATA_DIR in the background; returns < 0
+// if a dump is still running or there is nothing to dump
+int history_dump(void);
+
+#endif
@@ -0,0 +1,139 @@
+#include "latency.h"
+#include "evlog.h"
+#include "storage.h"
+
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/fcntl.h>
+#include <stdio.h>
+
+#define MAX_PENDING   8
+#define HISTORY_SIZE  256
+
+// Edges older than this are assumed to carry a bogus timestamp
+#define MAX_EDGE_AGE_US 1000000
+
+typedef struct {
+    uint8_t action;
+    uint32_t frame;       // Frame that rendered the change
+    uint64_t edge;
+    uint64_t rendered;
+    uint64_t flipped;
+} LatencyEvent;
+
+static const char *action_names[LATENCY_ACTION_COUNT] = {
+    "next", "prev", "speed", "toggle"
+};
+
+static LatencyDist dists[LATENCY_ACTION_COUNT];
+
+// Edges waiting for their frame to be rendered / flipped
+static LatencyEvent pending[MAX_PENDING];
+static int pending_count = 0;
+static uint32_t frame_counter = 0;
+
+static LatencyEvent history[HISTORY_SIZE];
+static uint32_t history_count = 0;    // Total ever recorded
+
+void latency_edge(LatencyAction action, uint64_t ctrl_time) {
+    if (pending_count >= MAX_PENDING) return;
+    uint64_t now = sceKernelGetSystemTimeWide();
+    if (ctrl_time == 0 || ctrl_time > now || now - ctrl_time > MAX_EDGE_AGE_US) {
+        ctrl_time = now;
+    }
+    LatencyEvent *e = &pending[pending_count++];
+    e->action = (uint8_t)action;
+    e->edge = ctrl_time;
+    e->rendered = 0;
+    e->flipped = 0;
+}
+
+void latency_rendered(void) {
+    uint64_t now = sceKernelGetSystemTimeWide();
+    for (int i = 0; i < pending_count; i++) {
+        if (pending[i].rendered == 0) {
+            pending[i].rendered = now;
+            pending[i].frame = frame_counter;
+        }
+    }
+    frame_counter++;
+}
+
+static void record(const LatencyEvent *e) {
+    uint32_t latency = (uint32_t)(e->flipped - e->edge);
+    LatencyDist *d = &dists[e->action];
+    if (d->count == 0 || latency < d->min_us) d->min_us = latency;
+    if (latency > d->max_us) d->max_us = latency;
+    d->total_us += latency;
+    d->count++;
+    uint32_t bucket = latency / LATENCY_BUCKET_US;
+    d->buckets[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    
+    history[history_count % HISTORY_SIZE] = *e;
+    history_count++;
+}
+
+void latency_flipped(void) {
+    uint64_t now = sceKernelGetSystemTimeWide();
+    int kept = 0;
+    for (int i = 0; i < pending_count; i++) {
+        if (pending[i].rendered != 0) {
+            pending[i].flipped = now;
+            record(&pending[i]);
+        } else {
+            pending[kept++] = pending[i];
+        }
+    }
+    pending_count = kept;
+}
+
+const char *latency_action_name(LatencyAction action) {
+    return action_names[action];
+}
+
+const LatencyDist *latency_dist(LatencyAction action) {
+    return &dists[action];
+}
+
+uint32_t latency_percentile(const LatencyDist *dist, int percent) {
+    if (dist->count == 0) return 0;
+    uint32_t target = (dist->count * (uint32_t)percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += dist->buckets[b];
+        if (seen >= target) {
+            uint32_t upper = (uint32_t)(b + 1) * LATENCY_BUCKET_US;
+            return upper < dist->max_us ? upper : dist->max_us;
+        }
+    }
+    return dist->max_us;
+}
+
+void latency_export(void) {
+    char path[128];
+    char line[128];
+    storage_path(path, sizeof(path), "latency.csv");
+    SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) return;
+    
+    int len = snprintf(line, sizeof(line), "action,frame,edge_us,render_latency_us,flip_latency_us\n");
+    sceIoWrite(fd, line, len);
+    uint32_t first = history_count > HISTORY_SIZE ? history_count - HISTORY_SIZE : 0;
+    for (uint32_t i = first; i < history_count; i++) {
+        const LatencyEvent *e = &history[i % HISTORY_SIZE];
+        len = snprintf(line, sizeof(line), "%s,%u,%llu,%u,%u\n",
+                       action_names[e->action], (unsigned)e->frame,
+                       (unsigned long long)e->edge,
+                       (unsigned)(e->rendered - e->edge), (unsigned)(e->flipped - e->edge));
+        sceIoWrite(fd, line, len);
+    }
+    sceIoClose(fd);
+    
+    for (int a = 0; a < LATENCY_ACTION_COUNT; a++) {
+        const LatencyDist *d = &dists[a];
+        if (d->count == 0) continue;
+        evlog_printf("latency: %s n=%u min %u us p50 %u us p95 %u us max %u us",
+                     action_names[a], (unsigned)d->count, (unsigned)d->min_us,
+                     (unsigned)latency_percentile(d, 50), (unsigned)latency_percentile(d, 95),
+                     (unsigned)d->max_us);
+    }
+}
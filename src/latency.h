@@ -0,0 +1,53 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// Input-to-flip latency tracer.
+//
+// Every handled button edge is stamped with the controller sample time
+// (SceCtrlData.timeStamp), then with the time the frame showing its
+// effect finished rendering and the time that frame was flipped. All
+// stamps use the system clock the controller reports in. Completed
+// events feed a histogram per action and a ring of recent events that is
+// exported as CSV.
+
+typedef enum {
+    LATENCY_NEXT,       // Next pattern
+    LATENCY_PREV,       // Previous pattern
+    LATENCY_SPEED,      // Animation speed up/down
+    LATENCY_TOGGLE,     // Info, profiler and latching toggles
+    LATENCY_ACTION_COUNT
+} LatencyAction;
+
+#define LATENCY_BUCKET_US 1000
+#define LATENCY_BUCKETS   64     // Last bucket collects everything slower
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[LATENCY_BUCKETS];   // Edge-to-flip latency histogram
+} LatencyDist;
+
+// Record a button edge handled this frame; ctrl_time is SceCtrlData.timeStamp
+void latency_edge(LatencyAction action, uint64_t ctrl_time);
+
+// Call once the frame is drawn, before waiting for vblank
+void latency_rendered(void);
+
+// Call right after the flip
+void latency_flipped(void);
+
+const char *latency_action_name(LatencyAction action);
+const LatencyDist *latency_dist(LatencyAction action);
+
+// Latency below which the given percentage (0-100) of events fell,
+// rounded up to the histogram resolution; 0 when nothing was recorded
+uint32_t latency_percentile(const LatencyDist *dist, int percent);
+
+// Write recent events and the per-action summary to APP_DATA_DIR
+void latency_export(void);
+
+#endif
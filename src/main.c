@@ -10,6 +10,18 @@
  * - Square/Triangle: Previous pattern
  * - Start: Exit application
  * - L/R: Adjust animation speed
+ * - Up: Toggle profiler HUD
+ * - Down: Toggle late input latching
+ * - Right + Down: Cycle the refresh rate (60/30/20/15 Hz)
+ * - Right + L: Mark panel defects (Select leaves marking mode)
+ * - Right + R: Show the defect map
+ * - Left: Toggle exposure heatmap
+ * - Right + Select: Dump the last ten seconds of frames
+ * - Right + Up: Toggle the binary timecode strip
+ *
+ * System suspend is handled between frames: state is saved before the
+ * system sleeps and only framebuffer or cache contents that did not
+ * survive are re-rendered afterwards.
  */
 
 #include <psp2/kernel/processmgr.h>
@@ -19,46 +31,27 @@
 #include <psp2/kernel/threadmgr.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
-#define SCREEN_WIDTH    960
-#define SCREEN_HEIGHT   544
-#define SCREEN_FB_WIDTH 960
-#define SCREEN_FB_SIZE  (2 * 1024 * 1024)
-
-// Colors in BGR format (Vita framebuffer format)
-#define COLOR_BLACK   0xFF000000
-#define COLOR_WHITE   0xFFFFFFFF
-#define COLOR_RED     0xFF0000FF
-#define COLOR_GREEN   0xFF00FF00
-#define COLOR_BLUE    0xFFFF0000
-#define COLOR_CYAN    0xFFFFFF00
-#define COLOR_MAGENTA 0xFFFF00FF
-#define COLOR_YELLOW  0xFF00FFFF
-#define COLOR_GRAY    0xFF808080
-#define COLOR_DARK_GRAY 0xFF404040
-
-typedef enum {
-    PATTERN_SOLID_RED,
-    PATTERN_SOLID_GREEN,
-    PATTERN_SOLID_BLUE,
-    PATTERN_SOLID_WHITE,
-    PATTERN_SOLID_BLACK,
-    PATTERN_SOLID_CYAN,
-    PATTERN_SOLID_MAGENTA,
-    PATTERN_SOLID_YELLOW,
-    PATTERN_GRADIENT_H,
-    PATTERN_GRADIENT_V,
-    PATTERN_CHECKERBOARD_SMALL,
-    PATTERN_CHECKERBOARD_LARGE,
-    PATTERN_HORIZONTAL_BARS,
-    PATTERN_VERTICAL_BARS,
-    PATTERN_MOVING_BAR_H,
-    PATTERN_MOVING_BAR_V,
-    PATTERN_COLOR_CYCLE,
-    PATTERN_INVERSION_TEST,
-    PATTERN_GRAY_LEVELS,
-    PATTERN_COUNT
-} TestPattern;
+#include "apl.h"
+#include "assets.h"
+#include "bands.h"
+#include "compositor.h"
+#include "defects.h"
+#include "display.h"
+#include "evlog.h"
+#include "exposure.h"
+#include "font.h"
+#include "frame_cache.h"
+#include "history.h"
+#include "latency.h"
+#include "patterns.h"
+#include "scheduler.h"
+#include "startup.h"
+#include "storage.h"
+#include "strategy.h"
+#include "suspend.h"
+#include "timecode.h"
 
 // Double buffering
 static void *framebuffers[2];
@@ -69,320 +62,30 @@ static void *draw_buffer;
 static int animation_frame = 0;
 static int animation_speed = 2;
 
-static uint32_t make_color_bgr(uint8_t r, uint8_t g, uint8_t b) {
-    return 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
-}
-
-static void fill_solid(uint32_t color) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    for (int i = 0; i < SCREEN_FB_WIDTH * SCREEN_HEIGHT; i++) {
-        pixels[i] = color;
-    }
-}
-
-static void draw_gradient_horizontal(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            uint8_t level = (x * 255) / SCREEN_WIDTH;
-            pixels[y * SCREEN_FB_WIDTH + x] = make_color_bgr(level, level, level);
-        }
-    }
-}
-
-static void draw_gradient_vertical(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        uint8_t level = (y * 255) / SCREEN_HEIGHT;
-        uint32_t color = make_color_bgr(level, level, level);
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            pixels[y * SCREEN_FB_WIDTH + x] = color;
-        }
-    }
-}
-
-static void draw_checkerboard(int cell_size) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            int checker = ((x / cell_size) + (y / cell_size)) % 2;
-            pixels[y * SCREEN_FB_WIDTH + x] = checker ? COLOR_WHITE : COLOR_BLACK;
-        }
-    }
-}
-
-static void draw_horizontal_bars(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    uint32_t colors[] = {COLOR_RED, COLOR_GREEN, COLOR_BLUE, COLOR_CYAN, 
-                         COLOR_MAGENTA, COLOR_YELLOW, COLOR_WHITE, COLOR_BLACK};
-    int bar_height = SCREEN_HEIGHT / 8;
-    
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        int color_idx = (y / bar_height) % 8;
-        uint32_t color = colors[color_idx];
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            pixels[y * SCREEN_FB_WIDTH + x] = color;
-        }
-    }
-}
-
-static void draw_vertical_bars(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    uint32_t colors[] = {COLOR_RED, COLOR_GREEN, COLOR_BLUE, COLOR_CYAN,
-                         COLOR_MAGENTA, COLOR_YELLOW, COLOR_WHITE, COLOR_BLACK};
-    int bar_width = SCREEN_WIDTH / 8;
-    
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            int color_idx = (x / bar_width) % 8;
-            pixels[y * SCREEN_FB_WIDTH + x] = colors[color_idx];
-        }
-    }
-}
-
-static void draw_moving_bar_horizontal(int frame) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    int bar_width = 64;
-    int bar_pos = (frame * animation_speed) % (SCREEN_WIDTH + bar_width);
-    
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            int in_bar = (x >= bar_pos - bar_width && x < bar_pos);
-            pixels[y * SCREEN_FB_WIDTH + x] = in_bar ? COLOR_WHITE : COLOR_BLACK;
-        }
-    }
-}
-
-static void draw_moving_bar_vertical(int frame) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    int bar_height = 64;
-    int bar_pos = (frame * animation_speed) % (SCREEN_HEIGHT + bar_height);
-    
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        int in_bar = (y >= bar_pos - bar_height && y < bar_pos);
-        uint32_t color = in_bar ? COLOR_WHITE : COLOR_BLACK;
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            pixels[y * SCREEN_FB_WIDTH + x] = color;
-        }
-    }
-}
-
-static void draw_color_cycle(int frame) {
-    int hue = (frame * animation_speed) % 360;
-    float h = hue / 60.0f;
-    int i = (int)h;
-    float f = h - i;
-    uint8_t v = 255;
-    uint8_t p = 0;
-    uint8_t q = (uint8_t)(255 * (1 - f));
-    uint8_t t = (uint8_t)(255 * f);
-    
-    uint8_t r, g, b;
-    switch (i % 6) {
-        case 0: r = v; g = t; b = p; break;
-        case 1: r = q; g = v; b = p; break;
-        case 2: r = p; g = v; b = t; break;
-        case 3: r = p; g = q; b = v; break;
-        case 4: r = t; g = p; b = v; break;
-        default: r = v; g = p; b = q; break;
-    }
-    
-    fill_solid(make_color_bgr(r, g, b));
-}
-
-static void draw_inversion_test(int frame) {
-    int phase = (frame / 60) % 2;
-    fill_solid(phase ? COLOR_WHITE : COLOR_BLACK);
-}
-
-static void draw_gray_levels(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    int num_levels = 16;
-    int bar_width = SCREEN_WIDTH / num_levels;
-    
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            int level_idx = x / bar_width;
-            if (level_idx >= num_levels) level_idx = num_levels - 1;
-            uint8_t gray = (level_idx * 255) / (num_levels - 1);
-            pixels[y * SCREEN_FB_WIDTH + x] = make_color_bgr(gray, gray, gray);
-        }
-    }
-}
-
-// ============================================
-// Font rendering system (4x6 tiny font)
-// ============================================
-
-// 4x6 font for characters (compact)
-static const uint8_t font_4x6[96][6] = {
-    {0x0,0x0,0x0,0x0,0x0,0x0}, // space
-    {0x4,0x4,0x4,0x0,0x4,0x0}, // !
-    {0xA,0xA,0x0,0x0,0x0,0x0}, // "
-    {0xA,0xF,0xA,0xF,0xA,0x0}, // #
-    {0x4,0xE,0xC,0x2,0xE,0x4}, // $
-    {0x9,0x2,0x4,0x8,0x9,0x0}, // %
-    {0x4,0xA,0x4,0xA,0x5,0x0}, // &
-    {0x4,0x4,0x0,0x0,0x0,0x0}, // '
-    {0x2,0x4,0x4,0x4,0x2,0x0}, // (
-    {0x4,0x2,0x2,0x2,0x4,0x0}, // )
-    {0x0,0xA,0x4,0xA,0x0,0x0}, // *
-    {0x0,0x4,0xE,0x4,0x0,0x0}, // +
-    {0x0,0x0,0x0,0x4,0x4,0x8}, // ,
-    {0x0,0x0,0xE,0x0,0x0,0x0}, // -
-    {0x0,0x0,0x0,0x0,0x4,0x0}, // .
-    {0x1,0x2,0x4,0x8,0x0,0x0}, // /
-    {0x6,0x9,0x9,0x9,0x6,0x0}, // 0
-    {0x4,0xC,0x4,0x4,0xE,0x0}, // 1
-    {0x6,0x9,0x2,0x4,0xF,0x0}, // 2
-    {0xE,0x1,0x6,0x1,0xE,0x0}, // 3
-    {0x2,0x6,0xA,0xF,0x2,0x0}, // 4
-    {0xF,0x8,0xE,0x1,0xE,0x0}, // 5
-    {0x6,0x8,0xE,0x9,0x6,0x0}, // 6
-    {0xF,0x1,0x2,0x4,0x4,0x0}, // 7
-    {0x6,0x9,0x6,0x9,0x6,0x0}, // 8
-    {0x6,0x9,0x7,0x1,0x6,0x0}, // 9
-    {0x0,0x4,0x0,0x4,0x0,0x0}, // :
-    {0x0,0x4,0x0,0x4,0x4,0x8}, // ;
-    {0x2,0x4,0x8,0x4,0x2,0x0}, // <
-    {0x0,0xE,0x0,0xE,0x0,0x0}, // =
-    {0x8,0x4,0x2,0x4,0x8,0x0}, // >
-    {0x6,0x9,0x2,0x0,0x4,0x0}, // ?
-    {0x6,0x9,0xB,0x8,0x6,0x0}, // @
-    {0x6,0x9,0xF,0x9,0x9,0x0}, // A
-    {0xE,0x9,0xE,0x9,0xE,0x0}, // B
-    {0x6,0x9,0x8,0x9,0x6,0x0}, // C
-    {0xE,0x9,0x9,0x9,0xE,0x0}, // D
-    {0xF,0x8,0xE,0x8,0xF,0x0}, // E
-    {0xF,0x8,0xE,0x8,0x8,0x0}, // F
-    {0x6,0x8,0xB,0x9,0x6,0x0}, // G
-    {0x9,0x9,0xF,0x9,0x9,0x0}, // H
-    {0xE,0x4,0x4,0x4,0xE,0x0}, // I
-    {0x7,0x1,0x1,0x9,0x6,0x0}, // J
-    {0x9,0xA,0xC,0xA,0x9,0x0}, // K
-    {0x8,0x8,0x8,0x8,0xF,0x0}, // L
-    {0x9,0xF,0xF,0x9,0x9,0x0}, // M
-    {0x9,0xD,0xB,0x9,0x9,0x0}, // N
-    {0x6,0x9,0x9,0x9,0x6,0x0}, // O
-    {0xE,0x9,0xE,0x8,0x8,0x0}, // P
-    {0x6,0x9,0x9,0xA,0x5,0x0}, // Q
-    {0xE,0x9,0xE,0xA,0x9,0x0}, // R
-    {0x6,0x8,0x6,0x1,0xE,0x0}, // S
-    {0xE,0x4,0x4,0x4,0x4,0x0}, // T
-    {0x9,0x9,0x9,0x9,0x6,0x0}, // U
-    {0x9,0x9,0x9,0x6,0x6,0x0}, // V
-    {0x9,0x9,0xF,0xF,0x9,0x0}, // W
-    {0x9,0x9,0x6,0x9,0x9,0x0}, // X
-    {0x9,0x9,0x6,0x4,0x4,0x0}, // Y
-    {0xF,0x1,0x6,0x8,0xF,0x0}, // Z
-    {0x6,0x4,0x4,0x4,0x6,0x0}, // [
-    {0x8,0x4,0x2,0x1,0x0,0x0}, // backslash
-    {0x6,0x2,0x2,0x2,0x6,0x0}, // ]
-    {0x4,0xA,0x0,0x0,0x0,0x0}, // ^
-    {0x0,0x0,0x0,0x0,0xF,0x0}, // _
-    {0x4,0x2,0x0,0x0,0x0,0x0}, // `
-    {0x0,0x6,0x9,0xB,0x5,0x0}, // a
-    {0x8,0xE,0x9,0x9,0xE,0x0}, // b
-    {0x0,0x6,0x8,0x8,0x6,0x0}, // c
-    {0x1,0x7,0x9,0x9,0x7,0x0}, // d
-    {0x0,0x6,0xF,0x8,0x6,0x0}, // e
-    {0x2,0x4,0xE,0x4,0x4,0x0}, // f
-    {0x0,0x7,0x9,0x7,0x1,0x6}, // g
-    {0x8,0xE,0x9,0x9,0x9,0x0}, // h
-    {0x4,0x0,0x4,0x4,0x4,0x0}, // i
-    {0x2,0x0,0x2,0x2,0xA,0x4}, // j
-    {0x8,0x9,0xA,0xC,0x9,0x0}, // k
-    {0x4,0x4,0x4,0x4,0x2,0x0}, // l
-    {0x0,0xA,0xF,0x9,0x9,0x0}, // m
-    {0x0,0xE,0x9,0x9,0x9,0x0}, // n
-    {0x0,0x6,0x9,0x9,0x6,0x0}, // o
-    {0x0,0xE,0x9,0xE,0x8,0x8}, // p
-    {0x0,0x7,0x9,0x7,0x1,0x1}, // q
-    {0x0,0x6,0x9,0x8,0x8,0x0}, // r
-    {0x0,0x7,0xC,0x3,0xE,0x0}, // s
-    {0x4,0xE,0x4,0x4,0x2,0x0}, // t
-    {0x0,0x9,0x9,0x9,0x6,0x0}, // u
-    {0x0,0x9,0x9,0x6,0x6,0x0}, // v
-    {0x0,0x9,0x9,0xF,0x6,0x0}, // w
-    {0x0,0x9,0x6,0x6,0x9,0x0}, // x
-    {0x0,0x9,0x9,0x7,0x1,0x6}, // y
-    {0x0,0xF,0x2,0x4,0xF,0x0}, // z
-    {0x2,0x4,0xC,0x4,0x2,0x0}, // {
-    {0x4,0x4,0x4,0x4,0x4,0x0}, // |
-    {0x8,0x4,0x6,0x4,0x8,0x0}, // }
-    {0x0,0x5,0xA,0x0,0x0,0x0}, // ~
-    {0xF,0xF,0xF,0xF,0xF,0xF}, // DEL (filled block)
-};
-
-static void draw_char(uint32_t *pixels, int x, int y, char c, int scale, uint32_t fg, uint32_t bg, int use_bg) {
-    int idx = c - 32;
-    if (idx < 0 || idx >= 96) idx = 0;
-    
-    for (int row = 0; row < 6; row++) {
-        uint8_t line = font_4x6[idx][row];
-        for (int col = 0; col < 4; col++) {
-            int set = (line >> (3 - col)) & 1;
-            if (set || use_bg) {
-                uint32_t color = set ? fg : bg;
-                for (int sy = 0; sy < scale; sy++) {
-                    for (int sx = 0; sx < scale; sx++) {
-                        int px = x + col * scale + sx;
-                        int py = y + row * scale + sy;
-                        if (px >= 0 && px < SCREEN_WIDTH && py >= 0 && py < SCREEN_HEIGHT) {
-                            pixels[py * SCREEN_FB_WIDTH + px] = color;
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-static void draw_string(uint32_t *pixels, int x, int y, const char *str, int scale, uint32_t fg, uint32_t bg, int use_bg) {
-    int orig_x = x;
-    while (*str) {
-        if (*str == '\n') {
-            y += 6 * scale + scale;
-            x = orig_x;
-        } else {
-            draw_char(pixels, x, y, *str, scale, fg, bg, use_bg);
-            x += 4 * scale + scale;
-        }
-        str++;
-    }
-}
+static int show_profiler = 0;
+static int show_heatmap = 0;
+static int show_timecode = 0;
+static int show_defects = 0;
+static uint32_t displayed_frames = 0;     // Main loop frames flipped so far
+static uint32_t last_frame_time = 0;
+static uint64_t last_flip_time = 0;
 
-static int get_string_width(const char *str, int scale) {
-    int width = 0;
-    int max_width = 0;
-    while (*str) {
-        if (*str == '\n') {
-            if (width > max_width) max_width = width;
-            width = 0;
-        } else {
-            width += 4 * scale + scale;
-        }
-        str++;
-    }
-    return (width > max_width) ? width : max_width;
-}
+// What the main loop needs to carry on where it was; saved to resume.bin
+// while the system sleeps
+typedef struct {
+    int pattern;
+    int animation_frame;
+    int animation_speed;
+    int show_info;
+    int info_timeout;
+    int show_timecode;
+    int refresh_divisor;
+    int show_defects;
+} ResumeState;
 
-// Draw a box with outline
-static void draw_box(uint32_t *pixels, int x, int y, int w, int h, uint32_t fill, uint32_t outline) {
-    for (int py = y; py < y + h && py < SCREEN_HEIGHT; py++) {
-        for (int px = x; px < x + w && px < SCREEN_WIDTH; px++) {
-            if (px >= 0 && py >= 0) {
-                int is_border = (px == x || px == x + w - 1 || py == y || py == y + h - 1);
-                pixels[py * SCREEN_FB_WIDTH + px] = is_border ? outline : fill;
-            }
-        }
-    }
-}
-
-// Draw pattern indicator with good contrast (outlined text)
-static void draw_pattern_indicator(int pattern_num, int total) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
-    
+// Pattern indicator layer with good contrast (outlined text), and the
+// pattern's hint from the asset pack below it if there is one
+static void update_pattern_indicator(int pattern_num, int total, const char *hint) {
     char buf[16];
     // Simple integer to string
     if (pattern_num >= 10) {
@@ -407,6 +110,19 @@ static void draw_pattern_indicator(int pattern_num, int total) {
     int box_y = 8;
     int box_w = text_w + 16;
     int box_h = text_h + 12;
+    int hint_lines = 0;
+    if (hint) {
+        for (const char *p = hint; *p; p++) {
+            if (p == hint || (p[-1] == '\n' && *p != '\n')) hint_lines++;
+        }
+        int hint_w = get_string_width(hint, 2);
+        if (hint_w + 16 > box_w) box_w = hint_w + 16;
+        box_h += 6 + hint_lines * 14;
+    }
+    
+    Rect area = {box_x, box_y, box_x + box_w, box_y + box_h};
+    uint32_t *pixels = compositor_begin(LAYER_INDICATOR, &area, ((uint64_t)pattern_num << 32) | (uint32_t)total);
+    if (!pixels) return;
     
     // Draw box with semi-transparent background
     draw_box(pixels, box_x, box_y, box_w, box_h, 0xD0000000, 0xFFFFFFFF);
@@ -422,13 +138,97 @@ static void draw_pattern_indicator(int pattern_num, int total) {
     draw_string(pixels, tx, ty + 1, buf, scale, COLOR_BLACK, 0, 0);
     // Draw main text (white)
     draw_string(pixels, tx, ty, buf, scale, COLOR_WHITE, 0, 0);
+    if (hint_lines > 0) {
+        draw_string(pixels, tx, ty + text_h + 8, hint, 2, COLOR_GRAY, 0, 0);
+    }
+    compositor_end(LAYER_INDICATOR);
 }
 
-// Draw welcome screen
-static void draw_welcome_screen(void) {
-    uint32_t *pixels = (uint32_t *)draw_buffer;
+// One line of the profiler HUD, gap pixels below the previous one
+typedef struct {
+    char text[64];
+    uint32_t color;
+    int gap;
+} HudLine;
+
+#define HUD_MAX_LINES (6 + STRATEGY_COUNT + LATENCY_ACTION_COUNT)
+
+// Profiler HUD layer: chosen render strategy, its cost and the measured
+// cost of every strategy that applies to the current pattern. The lines
+// are the layer's key, so the box is only redrawn when they change.
+static void update_profiler_hud(int pattern, RenderStrategy strategy) {
+    HudLine lines[HUD_MAX_LINES];
+    int n = 0;
+    memset(lines, 0, sizeof(lines));
+    
+    const PatternDesc *desc = pattern_get(pattern);
+    snprintf(lines[n].text, sizeof(lines[n].text), "PATTERN %s  PERIOD %d", desc->name,
+             pattern_period(desc, animation_speed));
+    lines[n++].color = COLOR_WHITE;
+    snprintf(lines[n].text, sizeof(lines[n].text), "STRATEGY %s", strategy_name(strategy));
+    lines[n++].color = COLOR_YELLOW;
+    snprintf(lines[n].text, sizeof(lines[n].text), "RENDER %u us  FRAME %u us",
+             (unsigned)strategy_last_cost(), (unsigned)last_frame_time);
+    lines[n++].color = last_frame_time > STRATEGY_VBLANK_BUDGET_US * (uint32_t)scheduler_divisor() + 1000 ?
+                       COLOR_RED : COLOR_WHITE;
+    const SchedulerStats *sched = scheduler_stats();
+    snprintf(lines[n].text, sizeof(lines[n].text), "LATCH %s  PREDICT %u us  LATENCY %u us  MISSED %u",
+             scheduler_enabled() ? "ON" : "OFF", (unsigned)sched->predicted_us,
+             (unsigned)sched->latency_us, (unsigned)sched->misses);
+    lines[n++].color = COLOR_CYAN;
+    snprintf(lines[n].text, sizeof(lines[n].text), "REFRESH %d Hz  ACTUAL %u.%02u Hz  HELD %u",
+             60 / scheduler_divisor(), (unsigned)(sched->rate_x100 / 100),
+             (unsigned)(sched->rate_x100 % 100), (unsigned)sched->held);
+    lines[n++].color = COLOR_CYAN;
+    const AplFrame *apl = apl_last();
+    snprintf(lines[n].text, sizeof(lines[n].text), "APL %u.%02u%%  R %u G %u B %u  %u us",
+             (unsigned)(apl->apl_x100 / 100), (unsigned)(apl->apl_x100 % 100),
+             (unsigned)(apl->mean_x100[0] / 100), (unsigned)(apl->mean_x100[1] / 100),
+             (unsigned)(apl->mean_x100[2] / 100), (unsigned)apl->cost_us);
+    lines[n++].color = COLOR_WHITE;
+    lines[n].gap = 4;
+    
+    for (int s = 0; s < STRATEGY_COUNT; s++) {
+        if (!strategy_applicable(pattern, s)) continue;
+        const StrategyStats *st = strategy_stats(pattern, s);
+        snprintf(lines[n].text, sizeof(lines[n].text), "%c %-14s %6u us  x%u", s == (int)strategy ? '>' : ' ',
+                 strategy_name(s), (unsigned)st->cost_us, (unsigned)st->samples);
+        lines[n++].color = s == (int)strategy ? COLOR_GREEN : COLOR_GRAY;
+    }
+    lines[n].gap += 4;
+    
+    // Edge-to-flip latency per action
+    for (int a = 0; a < LATENCY_ACTION_COUNT; a++) {
+        const LatencyDist *d = latency_dist(a);
+        snprintf(lines[n].text, sizeof(lines[n].text), "%-6s n %-4u p50 %5u  p95 %5u  max %5u us",
+                 latency_action_name(a), (unsigned)d->count,
+                 (unsigned)latency_percentile(d, 50), (unsigned)latency_percentile(d, 95),
+                 (unsigned)d->max_us);
+        lines[n++].color = d->count ? COLOR_WHITE : COLOR_DARK_GRAY;
+    }
     
-    // Dark blue gradient background
+    int box_w = 300;
+    int box_h = 84 + (STRATEGY_COUNT + LATENCY_ACTION_COUNT) * 10;
+    int box_x = 8;
+    int box_y = SCREEN_HEIGHT - box_h - 8;
+    Rect area = {box_x, box_y, box_x + box_w, box_y + box_h};
+    uint32_t *pixels = compositor_begin(LAYER_HUD, &area, compositor_hash(lines, sizeof(lines)));
+    if (!pixels) return;
+    
+    draw_box(pixels, box_x, box_y, box_w, box_h, COLOR_BLACK, COLOR_DARK_GRAY);
+    int tx = box_x + 8;
+    int ty = box_y + 8;
+    for (int i = 0; i < n; i++) {
+        ty += lines[i].gap;
+        draw_string(pixels, tx, ty, lines[i].text, 1, lines[i].color, 0, 0);
+        ty += 10;
+    }
+    compositor_end(LAYER_HUD);
+}
+
+// Dark blue gradient behind the welcome screen; also used as the
+// minimal first frame because it only costs one pass of row fills
+static void draw_welcome_background(uint32_t *pixels) {
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         uint8_t b = 40 + (y * 30) / SCREEN_HEIGHT;
         uint32_t color = make_color_bgr(10, 15, b);
@@ -436,6 +236,13 @@ static void draw_welcome_screen(void) {
             pixels[y * SCREEN_FB_WIDTH + x] = color;
         }
     }
+}
+
+// Draw welcome screen
+static void draw_welcome_screen(void) {
+    uint32_t *pixels = (uint32_t *)draw_buffer;
+    
+    draw_welcome_background(pixels);
     
     // Title
     const char *title = "Vita Screen Test";
@@ -483,8 +290,8 @@ static void draw_welcome_screen(void) {
         line_y += 25;
     }
     
-    // Press any button
-    const char *press = "Press X to start...";
+    // Press any button (only once background initialization is done)
+    const char *press = startup_is_ready() ? "Press X to start..." : "Loading...";
     int press_scale = 2;
     int press_w = get_string_width(press, press_scale);
     draw_string(pixels, (SCREEN_WIDTH - press_w) / 2 + 1, 440 + 1, press, press_scale, COLOR_BLACK, 0, 0);
@@ -495,77 +302,77 @@ static void draw_welcome_screen(void) {
     int cred_scale = 1;
     int cred_w = get_string_width(credits, cred_scale);
     draw_string(pixels, (SCREEN_WIDTH - cred_w) / 2, 500, credits, cred_scale, COLOR_GRAY, 0, 0);
+    
+    // Startup timing report
+    if (startup_is_ready()) {
+        char timing[64];
+        unsigned first = (unsigned)(startup_time_to_first_frame() / 100);
+        unsigned ready = (unsigned)(startup_time_to_ready() / 100);
+        snprintf(timing, sizeof(timing), "First frame %u.%u ms  Ready %u.%u ms",
+                 first / 10, first % 10, ready / 10, ready % 10);
+        int timing_w = get_string_width(timing, 1);
+        draw_string(pixels, (SCREEN_WIDTH - timing_w) / 2, 520, timing, 1, COLOR_DARK_GRAY, 0, 0);
+    }
 }
 
-static void draw_pattern(TestPattern pattern, int show_info) {
-    switch (pattern) {
-        case PATTERN_SOLID_RED:
-            fill_solid(COLOR_RED);
-            break;
-        case PATTERN_SOLID_GREEN:
-            fill_solid(COLOR_GREEN);
-            break;
-        case PATTERN_SOLID_BLUE:
-            fill_solid(COLOR_BLUE);
-            break;
-        case PATTERN_SOLID_WHITE:
-            fill_solid(COLOR_WHITE);
-            break;
-        case PATTERN_SOLID_BLACK:
-            fill_solid(COLOR_BLACK);
-            break;
-        case PATTERN_SOLID_CYAN:
-            fill_solid(COLOR_CYAN);
-            break;
-        case PATTERN_SOLID_MAGENTA:
-            fill_solid(COLOR_MAGENTA);
-            break;
-        case PATTERN_SOLID_YELLOW:
-            fill_solid(COLOR_YELLOW);
-            break;
-        case PATTERN_GRADIENT_H:
-            draw_gradient_horizontal();
-            break;
-        case PATTERN_GRADIENT_V:
-            draw_gradient_vertical();
-            break;
-        case PATTERN_CHECKERBOARD_SMALL:
-            draw_checkerboard(8);
-            break;
-        case PATTERN_CHECKERBOARD_LARGE:
-            draw_checkerboard(64);
-            break;
-        case PATTERN_HORIZONTAL_BARS:
-            draw_horizontal_bars();
-            break;
-        case PATTERN_VERTICAL_BARS:
-            draw_vertical_bars();
-            break;
-        case PATTERN_MOVING_BAR_H:
-            draw_moving_bar_horizontal(animation_frame);
-            break;
-        case PATTERN_MOVING_BAR_V:
-            draw_moving_bar_vertical(animation_frame);
-            break;
-        case PATTERN_COLOR_CYCLE:
-            draw_color_cycle(animation_frame);
-            break;
-        case PATTERN_INVERSION_TEST:
-            draw_inversion_test(animation_frame);
-            break;
-        case PATTERN_GRAY_LEVELS:
-            draw_gray_levels();
-            break;
-        default:
-            fill_solid(COLOR_BLACK);
-            break;
+// Timecode strip layer; it changes every frame
+static void update_timecode(int pattern) {
+    Rect area = timecode_area();
+    uint32_t *pixels = compositor_begin(LAYER_TIMECODE, &area, ((uint64_t)displayed_frames << 8) | (uint32_t)pattern);
+    if (!pixels) return;
+    timecode_draw(pixels, displayed_frames, pattern);
+    compositor_end(LAYER_TIMECODE);
+}
+
+// Show or hide the overlay layers for this frame. Runs before the base is
+// drawn, so the strategies can repair whatever a layer leaves behind.
+static void update_layers(int pattern, int show_info) {
+    defects_update_layers(show_defects);
+    if (show_info && !show_heatmap) {
+        const PatternDesc *desc = pattern_get(pattern);
+        update_pattern_indicator(pattern + 1, pattern_count(), assets_pattern_hint(desc->name));
+    } else {
+        compositor_hide(LAYER_INDICATOR);
     }
-    
-    if (show_info) {
-        draw_pattern_indicator(pattern + 1, PATTERN_COUNT);
+    // The HUD is drawn after the render it reports on
+    if (!show_profiler || show_heatmap) compositor_hide(LAYER_HUD);
+    if (show_timecode) {
+        update_timecode(pattern);
+    } else {
+        compositor_hide(LAYER_TIMECODE);
+    }
+}
+
+// What the layers put over the pattern, for the frame statistics
+static void account_layers(void) {
+    Rect areas[LAYER_COUNT];
+    int count = compositor_visible_rects(areas, LAYER_COUNT);
+    for (int i = 0; i < count; i++) {
+        apl_overlay((const uint32_t *)draw_buffer, &areas[i]);
+        history_overlay((const uint32_t *)draw_buffer, &areas[i]);
     }
 }
 
+static void draw_pattern(int pattern) {
+    uint32_t *pixels = (uint32_t *)draw_buffer;
+    const PatternDesc *desc = pattern_get(pattern);
+    PatternArgs args;
+    pattern_default_args(desc, &args);
+    
+    int state = pattern_state(desc, animation_frame, animation_speed);
+    RenderStrategy strategy = strategy_render(current_fb, pixels, pattern, &args, state);
+    exposure_frame(pattern, &args, state);
+    apl_begin_pattern(pattern, &args, state);
+    history_begin_pattern(pattern, &args, state);
+    
+    if (show_profiler) update_profiler_hud(pattern, strategy);
+    const Rect *repainted;
+    int repainted_count = strategy_repainted(&repainted);
+    compositor_flatten(current_fb, pixels, repainted, repainted_count);
+    account_layers();
+    apl_end_frame();
+}
+
 // Swap buffers (double buffering to prevent tearing)
 static void swap_buffers(void) {
     SceDisplayFrameBuf fb = {
@@ -577,22 +384,138 @@ static void swap_buffers(void) {
         .height = SCREEN_HEIGHT
     };
     
-    sceDisplayWaitVblankStart();
+    scheduler_wait_vblank();
     sceDisplaySetFrameBuf(&fb, SCE_DISPLAY_SETBUF_IMMEDIATE);
     
+    uint64_t now = sceKernelGetProcessTimeWide();
+    if (last_flip_time != 0) last_frame_time = (uint32_t)(now - last_flip_time);
+    last_flip_time = now;
+    scheduler_flipped(now);
+    latency_flipped();
+    history_flipped(now);
+    
     // Switch to other buffer for next frame
     current_fb = 1 - current_fb;
     draw_buffer = framebuffers[current_fb];
 }
 
+// Most controller samples read at once (the system buffers 64, one per
+// vblank)
+#define CTRL_MAX_SAMPLES 16
+
+static int last_ctrl_vcount = -1;
+
+// Read the controller samples taken since the last read (one per vblank)
+// so a tap shorter than a frame, at a reduced refresh rate or across a
+// missed vblank, still counts. ctrl gets every button down in any of
+// them, stamped with the first sample that shows a new press; returns the
+// buttons of the newest one.
+static uint32_t read_controller(SceCtrlData *ctrl, uint32_t old_buttons) {
+    SceCtrlData samples[CTRL_MAX_SAMPLES];
+    int vcount = sceDisplayGetVcount();
+    int wanted = last_ctrl_vcount < 0 ? 1 : (vcount - last_ctrl_vcount) & 0xFFFF;
+    last_ctrl_vcount = vcount;
+    if (wanted < 1) wanted = 1;
+    if (wanted > CTRL_MAX_SAMPLES) wanted = CTRL_MAX_SAMPLES;
+    int count = sceCtrlPeekBufferPositive(0, samples, wanted);
+    if (count < 1) {
+        memset(ctrl, 0, sizeof(*ctrl));
+        return 0;
+    }
+    int newest = 0;
+    int first_press = -1;
+    uint32_t buttons = 0;
+    for (int i = 0; i < count; i++) {
+        buttons |= samples[i].buttons;
+        if (samples[i].timeStamp > samples[newest].timeStamp) newest = i;
+        if ((samples[i].buttons & ~old_buttons) &&
+            (first_press < 0 || samples[i].timeStamp < samples[first_press].timeStamp)) {
+            first_press = i;
+        }
+    }
+    *ctrl = samples[newest];
+    ctrl->buttons = buttons;
+    if (first_press >= 0) ctrl->timeStamp = samples[first_press].timeStamp;
+    return samples[newest].buttons;
+}
+
+// At a reduced refresh rate a frame the screen already shows is neither
+// drawn nor flipped again. The profiler HUD reports on every frame, so
+// it keeps them coming while it is shown.
+static int frame_on_screen(int pattern) {
+    if (scheduler_divisor() == 1 || show_heatmap || show_profiler) return 0;
+    const PatternDesc *desc = pattern_get(pattern);
+    PatternArgs args;
+    pattern_default_args(desc, &args);
+    int state = pattern_state(desc, animation_frame, animation_speed);
+    int shown = 1 - current_fb;
+    return strategy_buffer_shows(shown, pattern, &args, state) && compositor_buffer_current(shown);
+}
+
+// Keep the last frame on screen through the vblank the next one was due at.
+// It still counts as shown: exposure slices long dwells and the APL
+// segment takes it again (the frame history extends its record at the
+// next flip).
+static void hold_frame(int pattern) {
+    const PatternDesc *desc = pattern_get(pattern);
+    PatternArgs args;
+    pattern_default_args(desc, &args);
+    exposure_frame(pattern, &args, pattern_state(desc, animation_frame, animation_speed));
+    apl_hold_frame();
+    
+    scheduler_wait_vblank();
+    scheduler_held(sceKernelGetProcessTimeWide());
+    latency_flipped();
+}
+
+// Called once the system is back from a suspend: keep whatever survived,
+// forget the rest, and restart frame timing from now
+static void resume_after_suspend(void) {
+    int lost_buffers = 0;
+    for (int i = 0; i < 2; i++) {
+        lost_buffers += strategy_check_buffer(i, (const uint32_t *)framebuffers[i]);
+    }
+    int lost_frames = frame_cache_verify();
+    
+    scheduler_resync();
+    last_flip_time = 0;
+    suspend_clear_state();
+    evlog_printf("suspend: resumed after %u ms, %d framebuffers and %d cached frames lost",
+                 (unsigned)(suspend_last_duration() / 1000), lost_buffers, lost_frames);
+}
+
+// Called when the system is about to sleep: fingerprint both buffers,
+// save the resume state and the exposure map and wait (without rendering)
+// for the resume
+static SuspendEvent enter_suspend(const ResumeState *state) {
+    for (int i = 0; i < 2; i++) {
+        strategy_fingerprint_buffer(i, (const uint32_t *)framebuffers[i]);
+    }
+    if (state && suspend_save_state(state, sizeof(*state)) < 0) {
+        evlog_printf("suspend: could not write resume.bin");
+    }
+    // The app may be closed while asleep, which skips exposure_term()
+    if (exposure_checkpoint() < 0) evlog_printf("suspend: could not write exposure.bin");
+    evlog_printf("suspend: entering");
+    evlog_flush();
+    
+    if (!suspend_wait_resume(SUSPEND_WAIT_US)) {
+        evlog_printf("suspend: system did not sleep, continuing");
+        suspend_clear_state();
+        return SUSPEND_NONE;
+    }
+    return suspend_poll();
+}
+
 int main(int argc, char *argv[]) {
     (void)argc;
     (void)argv;
     
-    // Initialize controller
-    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
-    
-    // Allocate double framebuffer memory
+    // ==================
+    // Stage 1: first frame
+    // ==================
+    // Only what is needed to put pixels on screen happens here. The
+    // framebuffers are not cleared: every frame overwrites the visible area.
     for (int i = 0; i < 2; i++) {
         fb_memblocks[i] = sceKernelAllocMemBlock("display", 
                                               SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW, 
@@ -602,13 +525,10 @@ int main(int argc, char *argv[]) {
             return -1;
         }
         sceKernelGetMemBlockBase(fb_memblocks[i], &framebuffers[i]);
-        memset(framebuffers[i], 0, SCREEN_FB_SIZE);
     }
     
-    draw_buffer = framebuffers[0];
-    current_fb = 0;
+    draw_welcome_background((uint32_t *)framebuffers[0]);
     
-    // Set up initial display
     SceDisplayFrameBuf fb = {
         .size = sizeof(SceDisplayFrameBuf),
         .base = framebuffers[0],
@@ -618,6 +538,26 @@ int main(int argc, char *argv[]) {
         .height = SCREEN_HEIGHT
     };
     sceDisplaySetFrameBuf(&fb, SCE_DISPLAY_SETBUF_NEXTFRAME);
+    startup_mark_first_frame();
+    
+    draw_buffer = framebuffers[1];
+    current_fb = 1;
+    
+    // ==================
+    // Stage 2: background initialization
+    // ==================
+    evlog_init();
+    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
+    if (suspend_init() < 0) {
+        evlog_printf("suspend: notifications unavailable");
+    }
+    
+    startup_add_task("data-dir", storage_ensure_dir);
+    startup_add_task("assets", assets_load);
+    startup_add_task("pattern-tables", pattern_init_tables);
+    startup_add_task("pattern-cache", strategy_prewarm_cache);
+    startup_add_task("apl-totals", apl_prewarm);
+    startup_run_background();
     
     SceCtrlData ctrl, ctrl_old;
     memset(&ctrl_old, 0, sizeof(ctrl_old));
@@ -625,8 +565,19 @@ int main(int argc, char *argv[]) {
     // ==================
     // Welcome Screen
     // ==================
+    // The welcome screen is static apart from the loading/ready footer, so
+    // each buffer is only re-rasterized when the content it holds is stale.
     int welcome_done = 0;
+    int welcome_version = 0;
+    int buffer_version[2] = {-1, -1};
     while (!welcome_done) {
+        SuspendEvent power = suspend_poll();
+        if (power == SUSPEND_ENTERING) power = enter_suspend(NULL);
+        if (power == SUSPEND_RESUMED) {
+            resume_after_suspend();
+            buffer_version[0] = buffer_version[1] = -1;
+        }
+        
         sceCtrlPeekBufferPositive(0, &ctrl, 1);
         uint32_t pressed = ctrl.buttons & ~ctrl_old.buttons;
         
@@ -636,24 +587,90 @@ int main(int argc, char *argv[]) {
         
         ctrl_old = ctrl;
         
-        draw_welcome_screen();
+        welcome_version = startup_is_ready() ? 1 : 0;
+        if (buffer_version[current_fb] != welcome_version) {
+            draw_welcome_screen();
+            buffer_version[current_fb] = welcome_version;
+        }
         swap_buffers();
     }
     
+    // Patterns may depend on data prepared in the background
+    startup_wait_ready();
+    strategy_init();
+    bands_init();
+    exposure_init();
+    history_init();
+    defects_init();
+    
     // ==================
     // Main Test Loop
     // ==================
-    TestPattern current_pattern = PATTERN_SOLID_RED;
+    int current_pattern = 0;
     int show_info = 1;
     int info_timeout = 180;
     
+    // A snapshot left behind means the last session never woke up from a
+    // suspend (battery ran out, app was closed): continue where it stopped
+    ResumeState resume;
+    if (suspend_load_state(&resume, sizeof(resume)) == 0 &&
+        resume.pattern >= 0 && resume.pattern < pattern_count() &&
+        resume.animation_speed >= 1 && resume.animation_speed <= 10 &&
+        resume.refresh_divisor >= 1 && resume.refresh_divisor <= SCHEDULER_MAX_DIVISOR) {
+        current_pattern = resume.pattern;
+        animation_frame = resume.animation_frame;
+        animation_speed = resume.animation_speed;
+        show_info = resume.show_info;
+        info_timeout = resume.info_timeout;
+        show_timecode = resume.show_timecode;
+        show_defects = resume.show_defects;
+        if (resume.refresh_divisor != 1) scheduler_set_divisor(resume.refresh_divisor);
+        evlog_printf("suspend: previous session ended asleep, continuing '%s' at frame %d",
+                     pattern_get(current_pattern)->name, animation_frame);
+        suspend_clear_state();
+    }
+    
     while (1) {
-        sceCtrlPeekBufferPositive(0, &ctrl, 1);
+        // Sample input as late as the predicted render cost allows
+        scheduler_latch();
+        
+        // Power events are handled between frames, where nothing is half drawn
+        SuspendEvent power = suspend_poll();
+        if (power == SUSPEND_ENTERING) {
+            ResumeState state = {
+                .pattern = current_pattern,
+                .animation_frame = animation_frame,
+                .animation_speed = animation_speed,
+                .show_info = show_info,
+                .info_timeout = info_timeout,
+                .show_timecode = show_timecode,
+                .refresh_divisor = scheduler_divisor(),
+                .show_defects = show_defects,
+            };
+            evlog_printf("suspend: saving '%s' at frame %d",
+                         pattern_get(current_pattern)->name, animation_frame);
+            power = enter_suspend(&state);
+        }
+        if (power == SUSPEND_RESUMED) resume_after_suspend();
+        
+        uint32_t latest = read_controller(&ctrl, ctrl_old.buttons);
         uint32_t pressed = ctrl.buttons & ~ctrl_old.buttons;
         
+        // While marking defects the D-pad and face buttons drive the cursor
+        if (defects_editing()) {
+            if (pressed & SCE_CTRL_SELECT) {
+                defects_set_editing(0);
+                latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+            } else {
+                defects_edit(pressed, ctrl.buttons);
+            }
+            pressed &= SCE_CTRL_START | SCE_CTRL_LTRIGGER | SCE_CTRL_RTRIGGER;
+        }
+        
         // Next pattern
         if (pressed & (SCE_CTRL_CROSS | SCE_CTRL_CIRCLE)) {
-            current_pattern = (current_pattern + 1) % PATTERN_COUNT;
+            current_pattern = (current_pattern + 1) % pattern_count();
+            latency_edge(LATENCY_NEXT, ctrl.timeStamp);
             animation_frame = 0;
             info_timeout = 180;
             show_info = 1;
@@ -661,26 +678,69 @@ int main(int argc, char *argv[]) {
         
         // Previous pattern
         if (pressed & (SCE_CTRL_SQUARE | SCE_CTRL_TRIANGLE)) {
-            current_pattern = (current_pattern + PATTERN_COUNT - 1) % PATTERN_COUNT;
+            current_pattern = (current_pattern + pattern_count() - 1) % pattern_count();
+            latency_edge(LATENCY_PREV, ctrl.timeStamp);
             animation_frame = 0;
             info_timeout = 180;
             show_info = 1;
         }
         
-        // Toggle info display
-        if (pressed & SCE_CTRL_SELECT) {
+        // Dump frame history (RIGHT held), otherwise toggle info display
+        if ((pressed & SCE_CTRL_SELECT) && (ctrl.buttons & SCE_CTRL_RIGHT)) {
+            if (history_dump() < 0) evlog_printf("history: dump not started");
+        } else if (pressed & SCE_CTRL_SELECT) {
             show_info = !show_info;
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
             info_timeout = show_info ? 180 : 0;
         }
         
+        // Toggle timecode strip (RIGHT held), otherwise profiler HUD
+        if ((pressed & SCE_CTRL_UP) && (ctrl.buttons & SCE_CTRL_RIGHT)) {
+            show_timecode = !show_timecode;
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+        } else if (pressed & SCE_CTRL_UP) {
+            show_profiler = !show_profiler;
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+        }
+        
+        // Toggle exposure heatmap
+        if (pressed & SCE_CTRL_LEFT) {
+            show_heatmap = !show_heatmap;
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+        }
+        
+        // Cycle the refresh divisor (RIGHT held), otherwise toggle late latching
+        if ((pressed & SCE_CTRL_DOWN) && (ctrl.buttons & SCE_CTRL_RIGHT)) {
+            scheduler_set_divisor(scheduler_divisor() % SCHEDULER_MAX_DIVISOR + 1);
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+        } else if (pressed & SCE_CTRL_DOWN) {
+            scheduler_set_enabled(!scheduler_enabled());
+            latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+        }
+        
+        // Defect map (RIGHT held): L starts or stops marking, R shows or hides the map
+        if (ctrl.buttons & SCE_CTRL_RIGHT) {
+            if (pressed & SCE_CTRL_LTRIGGER) {
+                defects_set_editing(!defects_editing());
+                latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+            }
+            if (pressed & SCE_CTRL_RTRIGGER) {
+                show_defects = !show_defects;
+                latency_edge(LATENCY_TOGGLE, ctrl.timeStamp);
+            }
+            pressed &= ~(SCE_CTRL_LTRIGGER | SCE_CTRL_RTRIGGER);
+        }
+        
         // Adjust speed
         if (pressed & SCE_CTRL_RTRIGGER) {
             animation_speed = (animation_speed < 10) ? animation_speed + 1 : 10;
+            latency_edge(LATENCY_SPEED, ctrl.timeStamp);
             info_timeout = 180;
             show_info = 1;
         }
         if (pressed & SCE_CTRL_LTRIGGER) {
             animation_speed = (animation_speed > 1) ? animation_speed - 1 : 1;
+            latency_edge(LATENCY_SPEED, ctrl.timeStamp);
             info_timeout = 180;
             show_info = 1;
         }
@@ -691,27 +751,66 @@ int main(int argc, char *argv[]) {
         }
         
         ctrl_old = ctrl;
+        ctrl_old.buttons = latest;
         
-        // Update animation
-        animation_frame++;
+        // Update animation; it counts the vblanks that passed since the last
+        // frame, so it keeps time whatever the refresh rate or missed vblanks
+        int ticks = scheduler_latched_vblanks();
+        animation_frame += ticks;
         
         // Auto-hide info after timeout
         if (info_timeout > 0) {
-            info_timeout--;
+            info_timeout = info_timeout > ticks ? info_timeout - ticks : 0;
             if (info_timeout == 0) {
                 show_info = 0;
             }
         }
         
-        // Draw current pattern
-        draw_pattern(current_pattern, show_info);
+        // Draw current pattern, or the exposure map in its place, with the
+        // overlay layers on top
+        update_layers(current_pattern, show_info);
+        if (frame_on_screen(current_pattern)) {
+            latency_rendered();
+            hold_frame(current_pattern);
+            continue;
+        }
+        compositor_prepare(current_fb);
+        if (show_heatmap) {
+            exposure_idle();
+            exposure_draw_heatmap((uint32_t *)draw_buffer);
+            compositor_flatten(current_fb, (uint32_t *)draw_buffer, NULL, -1);
+            apl_begin_view((uint32_t *)draw_buffer);
+            apl_end_frame();
+            history_begin_view((const uint32_t *)draw_buffer);
+            strategy_invalidate_buffers();
+        } else {
+            draw_pattern(current_pattern);
+        }
+        scheduler_render_done();
+        latency_rendered();
         
         // Swap buffers (vsync + flip)
         swap_buffers();
+        displayed_frames++;
     }
     
     // Cleanup
+    const SchedulerStats *sched = scheduler_stats();
+    evlog_printf("scheduler: latency %u us, %u of %u frames missed their vblank, %u held",
+                 (unsigned)sched->latency_us, (unsigned)sched->misses, (unsigned)sched->frames,
+                 (unsigned)sched->held);
+    latency_export();
+    bands_term();
+    defects_term();
+    exposure_term();
+    history_term();
+    apl_term();
+    assets_term();
+    compositor_term();
+    evlog_printf("exit");
+    evlog_flush();
     sceDisplaySetFrameBuf(NULL, SCE_DISPLAY_SETBUF_IMMEDIATE);
+    frame_cache_term();
     for (int i = 0; i < 2; i++) {
         sceKernelFreeMemBlock(fb_memblocks[i]);
     }
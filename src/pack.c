@@ -0,0 +1,73 @@
+#include "pack.h"
+#include "rle.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static int entry_valid(const uint8_t *base, const PackEntry *e, uint32_t data_start, uint32_t file_size) {
+    if (memchr(e->name, '\0', PACK_NAME_SIZE) == NULL || e->name[0] == '\0') return 0;
+    if (e->offset % PACK_ALIGN != 0 || e->offset < data_start) return 0;
+    // The terminating zero byte must be inside the file too
+    if (e->offset > file_size || e->size >= file_size - e->offset) return 0;
+
+    switch (e->encoding) {
+        case PACK_DATA:
+            return 1;
+        case PACK_PIXELS:
+            return (uint32_t)e->width * e->height * sizeof(uint32_t) == e->size;
+        case PACK_RLE: {
+            const RleFrame *frame = (const RleFrame *)(base + e->offset);
+            return e->size >= sizeof(RleFrame) && frame->size == e->size &&
+                   frame->width == e->width && frame->height == e->height;
+        }
+        default:
+            return 0;
+    }
+}
+
+int pack_open(Pack *pack, const void *data, uint32_t size) {
+    const uint8_t *base = (const uint8_t *)data;
+    const PackHeader *header = (const PackHeader *)base;
+    if (size < sizeof(PackHeader)) return -1;
+    if (header->magic != PACK_MAGIC || header->version != PACK_VERSION) return -1;
+    if (header->file_size != size) return -1;
+    if (header->entry_count > (size - sizeof(PackHeader)) / sizeof(PackEntry)) return -1;
+
+    const PackEntry *toc = (const PackEntry *)(header + 1);
+    uint32_t data_start = sizeof(PackHeader) + header->entry_count * sizeof(PackEntry);
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        if (!entry_valid(base, &toc[i], data_start, size)) return -1;
+        if (i > 0 && strcmp(toc[i - 1].name, toc[i].name) >= 0) return -1;
+    }
+
+    pack->base = base;
+    pack->size = size;
+    pack->toc = toc;
+    pack->count = header->entry_count;
+    return 0;
+}
+
+const PackEntry *pack_find(const Pack *pack, const char *name) {
+    uint32_t lo = 0;
+    uint32_t hi = pack->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int order = strcmp(pack->toc[mid].name, name);
+        if (order == 0) return &pack->toc[mid];
+        if (order < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+uint32_t pack_checksum(const void *data, uint32_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t hash = 2166136261u;
+    while (size-- > 0) {
+        hash = (hash ^ *p++) * 16777619u;
+    }
+    return hash;
+}
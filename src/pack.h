@@ -0,0 +1,75 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdint.h>
+
+// Indexed asset pack.
+//
+// One file holds every asset so loading is a few large sequential reads
+// instead of many small opens. The layout is position independent and is
+// used in place once in memory:
+//
+//   PackHeader | PackEntry toc[entry_count] | entry data...
+//
+// The table of contents is sorted by name, so lookups are a binary search
+// and opening a pack only bounds-checks the table; nothing is parsed or
+// copied per entry. Entry data starts on PACK_ALIGN boundaries and is
+// followed by at least one zero byte, so text entries are C strings.
+// Packs are built by host/pack_tool.
+
+#define PACK_MAGIC     0x4B505356   // "VSPK"
+#define PACK_VERSION   1
+#define PACK_ALIGN     64
+#define PACK_NAME_SIZE 40
+
+typedef enum {
+    PACK_DATA,      // Bytes as stored
+    PACK_PIXELS,    // width x height pixels (0xAABBGGRR), no padding
+    PACK_RLE,       // RleFrame blob, expanded with rle_decode() when drawn
+} PackEncoding;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t entry_count;
+    uint32_t file_size;
+} PackHeader;
+
+typedef struct {
+    char name[PACK_NAME_SIZE];    // NUL terminated
+    uint32_t offset;              // From the start of the pack
+    uint32_t size;                // Stored bytes
+    uint32_t checksum;            // pack_checksum() of the stored bytes
+    uint16_t encoding;
+    uint16_t width;               // Images only
+    uint16_t height;
+    uint16_t reserved;
+    uint32_t reserved2;
+} PackEntry;
+
+_Static_assert(sizeof(PackHeader) == 16, "PackHeader layout");
+_Static_assert(sizeof(PackEntry) == 64, "PackEntry layout");
+
+typedef struct {
+    const uint8_t *base;
+    uint32_t size;
+    const PackEntry *toc;
+    uint32_t count;
+} Pack;
+
+// Check a pack image of size bytes at base and fill *pack; returns < 0 if
+// the header or table of contents is malformed. base must stay valid.
+int pack_open(Pack *pack, const void *base, uint32_t size);
+
+// Entry with this name, or NULL
+const PackEntry *pack_find(const Pack *pack, const char *name);
+
+static inline const void *pack_data(const Pack *pack, const PackEntry *entry) {
+    return pack->base + entry->offset;
+}
+
+// FNV-1a over size bytes
+uint32_t pack_checksum(const void *data, uint32_t size);
+
+#endif
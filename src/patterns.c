@@ -0,0 +1,699 @@
+#include "patterns.h"
+#include "color.h"
+#include "raster.h"
+#include "span.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MOVING_BAR_SIZE 64
+
+// Geometry patterns are laid out around the screen center
+#define GEOMETRY_CX (SCREEN_WIDTH / 2)
+#define GEOMETRY_CY (SCREEN_HEIGHT / 2)
+
+// Radial gradient: squared distance from the center, in steps of
+// 1 << RADIAL_SHIFT, indexes a level table
+#define RADIAL_CX    (SCREEN_WIDTH / 2)
+#define RADIAL_CY    (SCREEN_HEIGHT / 2)
+#define RADIAL_MAX_D2 (RADIAL_CX * RADIAL_CX + RADIAL_CY * RADIAL_CY)
+#define RADIAL_SHIFT 4
+
+// Zone plate phase is ZONE_PLATE_K * r^2 in 2^-32 turns, so the rings
+// reach half a cycle per pixel (the Nyquist limit) at the left and right
+// edges: 2^32 / (4 * RADIAL_CX)
+#define ZONE_PLATE_K 2236962
+
+// Sine sweep phase is SINE_SWEEP_K * x^2, half a cycle per pixel at the
+// right edge: 2^32 / (4 * SCREEN_WIDTH)
+#define SINE_SWEEP_K 1118481
+
+// Waves start a quarter turn in, at their peak, so a two pixel grating
+// alternates black and white
+#define WAVE_PEAK 0x40000000u
+
+static uint8_t radial_levels[(RADIAL_MAX_D2 >> RADIAL_SHIFT) + 1];
+static int32_t sin_q16[360];     // sin(degrees) in 16.16 fixed point
+
+// Channel multipliers for ramp_span, indexed by the "channel" parameter
+static const uint32_t channel_mul[3] = {0x000001, 0x000100, 0x010000};
+
+static void fill_rect(uint32_t *pixels, const Rect *r, uint32_t color) {
+    for (int y = r->y0; y < r->y1; y++) {
+        fill_span(pixels + y * SCREEN_FB_WIDTH + r->x0, color, r->x1 - r->x0);
+    }
+}
+
+// ============================================
+// Painters
+// ============================================
+
+static uint32_t solid_color(const PatternArgs *args, int state) {
+    (void)state;
+    return 0xFF000000 | (uint32_t)args->v[0];
+}
+
+static void paint_solid(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    fill_rect(pixels, r, solid_color(args, state));
+}
+
+static void paint_gradient_horizontal(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    // x * 255 / SCREEN_WIDTH on the first row, copied to the others (a
+    // 16.16 ramp is only exact when SCREEN_WIDTH divides 255 << 16)
+    uint32_t *first = pixels + r->y0 * SCREEN_FB_WIDTH;
+    for (int x = r->x0; x < r->x1; x++) {
+        uint8_t level = (x * 255) / SCREEN_WIDTH;
+        first[x] = make_color_bgr(level, level, level);
+    }
+    for (int y = r->y0 + 1; y < r->y1; y++) {
+        memcpy(pixels + y * SCREEN_FB_WIDTH + r->x0, first + r->x0, (size_t)(r->x1 - r->x0) * sizeof(uint32_t));
+    }
+}
+
+static void paint_gradient_vertical(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    for (int y = r->y0; y < r->y1; y++) {
+        uint8_t level = (y * 255) / SCREEN_HEIGHT;
+        uint32_t color = make_color_bgr(level, level, level);
+        fill_span(pixels + y * SCREEN_FB_WIDTH + r->x0, color, r->x1 - r->x0);
+    }
+}
+
+// Full 0-255 ramp in one channel from the left edge to the right edge
+static void paint_gradient_channel(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    int32_t step = (255 << 16) / (SCREEN_WIDTH - 1);
+    int32_t start = r->x0 * step + 0x8000;
+    for (int y = r->y0; y < r->y1; y++) {
+        ramp_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, start, step,
+                  channel_mul[args->v[0]]);
+    }
+}
+
+// Gray ramp along a direction, black at the first screen corner it meets
+// and white at the last. The level is linear in x and y, so each row is a
+// fixed-point ramp and rows differ only by their start value.
+static void paint_gradient_angled(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    int angle = (args->v[0] + state) % 360;
+    int64_t c = sin_q16[(angle + 90) % 360];
+    int64_t s = sin_q16[angle];
+    
+    // Project the corners onto the direction to find the range
+    static const int corners[4][2] = {
+        {0, 0}, {SCREEN_WIDTH - 1, 0}, {0, SCREEN_HEIGHT - 1}, {SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1}
+    };
+    int64_t lo = INT64_MAX;
+    int64_t hi = INT64_MIN;
+    for (int i = 0; i < 4; i++) {
+        int64_t p = corners[i][0] * c + corners[i][1] * s;
+        if (p < lo) lo = p;
+        if (p > hi) hi = p;
+    }
+    int64_t range = hi > lo ? hi - lo : 1;
+    
+    // level = (x * c + y * s - lo) * 255 / range, in 16.16
+    int32_t step_x = (int32_t)((c * (255 << 16)) / range);
+    int32_t step_y = (int32_t)((s * (255 << 16)) / range);
+    int32_t base = (int32_t)((-lo * (255 << 16)) / range) + 0x8000;
+    
+    for (int y = r->y0; y < r->y1; y++) {
+        int32_t start = base + r->x0 * step_x + y * step_y;
+        ramp_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, start, step_x, 0x010101);
+    }
+}
+
+// The ramp spans the screen corner to corner and the screen is symmetric
+// about its center, so every angle averages to mid gray (rounding aside)
+static void gradient_angled_totals(const PatternArgs *args, int state, uint64_t totals[3]) {
+    (void)args;
+    (void)state;
+    uint64_t total = (uint64_t)SCREEN_WIDTH * SCREEN_HEIGHT * 255 / 2;
+    totals[0] = totals[1] = totals[2] = total;
+}
+
+// White in the center falling to black in the corners. The squared
+// distance is stepped incrementally along each row (d2 += 2 * dx + 1), so
+// there is no multiply, divide or square root per pixel.
+static void paint_gradient_radial(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    for (int y = r->y0; y < r->y1; y++) {
+        uint32_t *dst = pixels + y * SCREEN_FB_WIDTH;
+        int dy = y - RADIAL_CY;
+        int dx = r->x0 - RADIAL_CX;
+        int d2 = dx * dx + dy * dy;
+        for (int x = r->x0; x < r->x1; x++) {
+            uint32_t level = radial_levels[d2 >> RADIAL_SHIFT];
+            dst[x] = 0xFF000000 | (level * 0x010101);
+            d2 += 2 * dx + 1;
+            dx++;
+        }
+    }
+}
+
+static void paint_checkerboard(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    int cell_size = args->v[0];
+    for (int y = r->y0; y < r->y1; y++) {
+        for (int x = r->x0; x < r->x1; x++) {
+            int checker = ((x / cell_size) + (y / cell_size)) % 2;
+            pixels[y * SCREEN_FB_WIDTH + x] = checker ? COLOR_WHITE : COLOR_BLACK;
+        }
+    }
+}
+
+// Two cells each way
+static void checkerboard_tile_size(const PatternArgs *args, int *width, int *height) {
+    *width = *height = 2 * args->v[0];
+}
+
+static const uint32_t bar_colors[] = {COLOR_RED, COLOR_GREEN, COLOR_BLUE, COLOR_CYAN,
+                                      COLOR_MAGENTA, COLOR_YELLOW, COLOR_WHITE, COLOR_BLACK};
+
+static void paint_horizontal_bars(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    int bar_height = SCREEN_HEIGHT / 8;
+    
+    for (int y = r->y0; y < r->y1; y++) {
+        int color_idx = (y / bar_height) % 8;
+        fill_span(pixels + y * SCREEN_FB_WIDTH + r->x0, bar_colors[color_idx], r->x1 - r->x0);
+    }
+}
+
+static void paint_vertical_bars(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    int bar_width = SCREEN_WIDTH / 8;
+    
+    for (int y = r->y0; y < r->y1; y++) {
+        for (int x = r->x0; x < r->x1; x++) {
+            int color_idx = (x / bar_width) % 8;
+            pixels[y * SCREEN_FB_WIDTH + x] = bar_colors[color_idx];
+        }
+    }
+}
+
+static void paint_moving_bar_horizontal(uint32_t *pixels, const Rect *r, const PatternArgs *args, int bar_pos) {
+    (void)args;
+    for (int y = r->y0; y < r->y1; y++) {
+        for (int x = r->x0; x < r->x1; x++) {
+            int in_bar = (x >= bar_pos - MOVING_BAR_SIZE && x < bar_pos);
+            pixels[y * SCREEN_FB_WIDTH + x] = in_bar ? COLOR_WHITE : COLOR_BLACK;
+        }
+    }
+}
+
+static void paint_moving_bar_vertical(uint32_t *pixels, const Rect *r, const PatternArgs *args, int bar_pos) {
+    (void)args;
+    for (int y = r->y0; y < r->y1; y++) {
+        int in_bar = (y >= bar_pos - MOVING_BAR_SIZE && y < bar_pos);
+        uint32_t color = in_bar ? COLOR_WHITE : COLOR_BLACK;
+        fill_span(pixels + y * SCREEN_FB_WIDTH + r->x0, color, r->x1 - r->x0);
+    }
+}
+
+// Clamp the band [a, b) along one axis into a rect; returns 0 if empty
+static int band_rect(Rect *out, int horizontal, int a, int b) {
+    int limit = horizontal ? SCREEN_WIDTH : SCREEN_HEIGHT;
+    if (a < 0) a = 0;
+    if (b > limit) b = limit;
+    if (a >= b) return 0;
+    
+    if (horizontal) {
+        out->x0 = a; out->x1 = b;
+        out->y0 = 0; out->y1 = SCREEN_HEIGHT;
+    } else {
+        out->x0 = 0; out->x1 = SCREEN_WIDTH;
+        out->y0 = a; out->y1 = b;
+    }
+    return 1;
+}
+
+// Only the old and the new bar position need repainting
+static int moving_bar_changed(int horizontal, int old_state, int new_state, Rect *out, int max) {
+    int count = 0;
+    if (max < 2) return -1;
+    if (old_state == new_state) return 0;
+    count += band_rect(&out[count], horizontal, old_state - MOVING_BAR_SIZE, old_state);
+    count += band_rect(&out[count], horizontal, new_state - MOVING_BAR_SIZE, new_state);
+    return count;
+}
+
+static int moving_bar_horizontal_changed(int old_state, int new_state, Rect *out, int max) {
+    return moving_bar_changed(1, old_state, new_state, out, max);
+}
+
+static int moving_bar_vertical_changed(int old_state, int new_state, Rect *out, int max) {
+    return moving_bar_changed(0, old_state, new_state, out, max);
+}
+
+static uint32_t color_cycle_color(const PatternArgs *args, int hue) {
+    (void)args;
+    return color_hsv(hue * COLOR_HUE_STEPS / 360, 255, 255);
+}
+
+static void paint_color_cycle(uint32_t *pixels, const Rect *r, const PatternArgs *args, int hue) {
+    fill_rect(pixels, r, color_cycle_color(args, hue));
+}
+
+// One full turn of hue across the screen, scrolling by a degree per state
+static void paint_hue_sweep(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    int32_t step = (COLOR_HUE_STEPS << 16) / SCREEN_WIDTH;
+    int32_t start = ((state * COLOR_HUE_STEPS / 360) << 16) + r->x0 * step;
+    for (int y = r->y0; y < r->y1; y++) {
+        color_hue_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, start, step);
+    }
+}
+
+// Gray ramp whose input (linear light or L*) is even across the screen,
+// encoded through a transfer curve
+static void paint_curve_ramp(uint32_t *pixels, const Rect *r, const uint8_t *curve) {
+    int32_t step = ((COLOR_CURVE_SIZE - 1) << 16) / (SCREEN_WIDTH - 1);
+    int32_t start = r->x0 * step + 0x8000;
+    for (int y = r->y0; y < r->y1; y++) {
+        color_curve_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, start, step, curve, 0x010101);
+    }
+}
+
+static void paint_gradient_linear(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    paint_curve_ramp(pixels, r, color_srgb_curve());
+}
+
+static void paint_gradient_lstar(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    paint_curve_ramp(pixels, r, color_lstar_curve());
+}
+
+static void paint_gradient_gamma(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    paint_curve_ramp(pixels, r, color_gamma_curve(args->v[0]));
+}
+
+// Rec. 709 chroma plane at a fixed Y': Cb from 0 to 255 left to right, Cr
+// from 255 to 0 top to bottom. Every row is a set of R'G'B' ramps, which
+// start at the left edge whatever the rect so a partial repaint matches
+// the full frame.
+static void paint_chroma_plane(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    int32_t cb_step = (255 << 16) / (SCREEN_WIDTH - 1);
+    int32_t cr_step = -(255 << 16) / (SCREEN_HEIGHT - 1);
+    const int32_t ycc_step[3] = {0, cb_step, 0};
+    for (int y = r->y0; y < r->y1; y++) {
+        const int32_t ycc[3] = {args->v[0] << 16, 0, (255 << 16) + y * cr_step};
+        int32_t rgb[3];
+        int32_t rgb_step[3];
+        color_ycbcr709_ramp(ycc, ycc_step, rgb, rgb_step);
+        for (int c = 0; c < 3; c++) rgb[c] += r->x0 * rgb_step[c];
+        color_ramp_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, rgb, rgb_step);
+    }
+}
+
+static uint32_t inversion_color(const PatternArgs *args, int phase) {
+    (void)args;
+    return phase ? COLOR_WHITE : COLOR_BLACK;
+}
+
+static void paint_inversion_test(uint32_t *pixels, const Rect *r, const PatternArgs *args, int phase) {
+    fill_rect(pixels, r, inversion_color(args, phase));
+}
+
+static void paint_gray_levels(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    int num_levels = args->v[0];
+    int bar_width = SCREEN_WIDTH / num_levels;
+    
+    for (int y = r->y0; y < r->y1; y++) {
+        for (int x = r->x0; x < r->x1; x++) {
+            int level_idx = x / bar_width;
+            if (level_idx >= num_levels) level_idx = num_levels - 1;
+            uint8_t gray = (level_idx * 255) / (num_levels - 1);
+            pixels[y * SCREEN_FB_WIDTH + x] = make_color_bgr(gray, gray, gray);
+        }
+    }
+}
+
+// Circular zone plate around the center, its rings moving outward by a
+// 64th of a cycle per state. Along a row the phase is quadratic in x, so
+// color_wave_span advances it with two additions per pixel.
+static void paint_zone_plate(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    uint32_t offset = WAVE_PEAK - ((uint32_t)state << 26);
+    int dx = r->x0 - RADIAL_CX;
+    uint32_t delta = (uint32_t)(2 * dx + 1) * ZONE_PLATE_K;
+    for (int y = r->y0; y < r->y1; y++) {
+        int dy = y - RADIAL_CY;
+        uint32_t phase = (uint32_t)(dx * dx + dy * dy) * ZONE_PLATE_K + offset;
+        color_wave_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, phase, delta, 2 * ZONE_PLATE_K);
+    }
+}
+
+// The phase over a disk is uniformly distributed (every ring has the same
+// area), so the screen averages to mid gray up to the partial rings
+static void zone_plate_totals(const PatternArgs *args, int state, uint64_t totals[3]) {
+    (void)args;
+    (void)state;
+    uint64_t total = (uint64_t)SCREEN_WIDTH * SCREEN_HEIGHT * 255 / 2;
+    totals[0] = totals[1] = totals[2] = total;
+}
+
+// Vertical sine stripes `period` pixels apart
+static void paint_sine_grating(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    uint32_t delta = (uint32_t)(((uint64_t)1 << 32) / (uint32_t)args->v[0]);
+    uint32_t phase = WAVE_PEAK + (uint32_t)r->x0 * delta;
+    for (int y = r->y0; y < r->y1; y++) {
+        color_wave_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, phase, delta, 0);
+    }
+}
+
+// Sine stripes whose frequency rises linearly from zero at the left edge
+// to half a cycle per pixel at the right edge
+static void paint_sine_sweep(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    uint32_t x = (uint32_t)r->x0;
+    uint32_t phase = WAVE_PEAK + x * x * SINE_SWEEP_K;
+    uint32_t delta = (2 * x + 1) * SINE_SWEEP_K;
+    for (int y = r->y0; y < r->y1; y++) {
+        color_wave_span(pixels + y * SCREEN_FB_WIDTH + r->x0, r->x1 - r->x0, phase, delta, 2 * SINE_SWEEP_K);
+    }
+}
+
+static const Rect screen_rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+// One pixel white lines every `cell` pixels from the top left corner, with
+// the last row and column closing the grid at the screen edges
+static void paint_grid(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    fill_rect(pixels, r, COLOR_BLACK);
+    raster_grid(pixels, r, &screen_rect, args->v[0], args->v[0], 1, COLOR_WHITE);
+}
+
+// Grid with gray 45-degree diagonals through every grid point
+static void paint_crosshatch(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)state;
+    int cell = args->v[0];
+    fill_rect(pixels, r, COLOR_BLACK);
+    for (int d = -(SCREEN_HEIGHT / cell + 1) * cell; d < SCREEN_WIDTH + SCREEN_HEIGHT; d += cell) {
+        raster_line(pixels, r, d, 0, d + SCREEN_HEIGHT - 1, SCREEN_HEIGHT - 1, COLOR_GRAY);
+        raster_line(pixels, r, d, 0, d - (SCREEN_HEIGHT - 1), SCREEN_HEIGHT - 1, COLOR_GRAY);
+    }
+    raster_grid(pixels, r, &screen_rect, cell, cell, 1, COLOR_WHITE);
+}
+
+// Convergence and geometry chart: center cross, concentric circles, an
+// ellipse touching all four edges, circles in the corners and
+// anti-aliased spokes every 15 degrees. Circles that come out as ellipses
+// or spokes that bend show scaling and alignment errors.
+static void paint_convergence(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state) {
+    (void)args;
+    (void)state;
+    fill_rect(pixels, r, COLOR_BLACK);
+    
+    for (int angle = 0; angle < 360; angle += 15) {
+        int32_t c = sin_q16[(angle + 90) % 360];
+        int32_t s = sin_q16[angle];
+        raster_line_aa(pixels, r, GEOMETRY_CX + ((32 * c) >> 16), GEOMETRY_CY + ((32 * s) >> 16),
+                       GEOMETRY_CX + ((240 * c) >> 16), GEOMETRY_CY + ((240 * s) >> 16), COLOR_GRAY);
+    }
+    for (int radius = 64; radius < GEOMETRY_CY; radius += 64) {
+        raster_circle(pixels, r, GEOMETRY_CX, GEOMETRY_CY, radius, COLOR_WHITE);
+    }
+    raster_ellipse(pixels, r, GEOMETRY_CX, GEOMETRY_CY, GEOMETRY_CX - 1, GEOMETRY_CY - 1, COLOR_WHITE);
+    
+    static const RasterPoint corners[4] = {
+        {48, 48}, {SCREEN_WIDTH - 49, 48}, {48, SCREEN_HEIGHT - 49}, {SCREEN_WIDTH - 49, SCREEN_HEIGHT - 49}
+    };
+    for (int i = 0; i < 4; i++) {
+        raster_circle(pixels, r, corners[i].x, corners[i].y, 40, COLOR_WHITE);
+        raster_fill_ellipse(pixels, r, corners[i].x, corners[i].y, 2, 2, COLOR_WHITE);
+    }
+    
+    // Center cross and a frame along the screen edges
+    raster_hline(pixels, r, 0, SCREEN_WIDTH, GEOMETRY_CY, COLOR_WHITE);
+    raster_vline(pixels, r, GEOMETRY_CX, 0, SCREEN_HEIGHT, COLOR_WHITE);
+    static const RasterPoint frame[5] = {
+        {0, 0}, {SCREEN_WIDTH - 1, 0}, {SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1}, {0, SCREEN_HEIGHT - 1}, {0, 0}
+    };
+    raster_polyline(pixels, r, frame, 5, COLOR_WHITE);
+}
+
+// ============================================
+// Registry
+// ============================================
+
+#define SOLID_FLAGS (PATTERN_SOLID | PATTERN_ROWS_SAME | PATTERN_COLUMNS_SAME | PATTERN_TILEABLE)
+
+#define SOLID_PATTERN(label, color) { \
+    .name = label, .flags = SOLID_FLAGS, .paint = paint_solid, .solid_color = solid_color, \
+    .cycle = 1, .tile_width = 1, .tile_height = 1, \
+    .param_count = 1, .params = {{"bgr", 0, 0xFFFFFF, (color) & 0xFFFFFF}} }
+
+static const PatternDesc registry[] = {
+    SOLID_PATTERN("Red", COLOR_RED),
+    SOLID_PATTERN("Green", COLOR_GREEN),
+    SOLID_PATTERN("Blue", COLOR_BLUE),
+    SOLID_PATTERN("White", COLOR_WHITE),
+    SOLID_PATTERN("Black", COLOR_BLACK),
+    SOLID_PATTERN("Cyan", COLOR_CYAN),
+    SOLID_PATTERN("Magenta", COLOR_MAGENTA),
+    SOLID_PATTERN("Yellow", COLOR_YELLOW),
+    {
+        .name = "Gradient H", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_horizontal, .cycle = 1,
+    },
+    {
+        .name = "Gradient V", .flags = PATTERN_COLUMNS_SAME,
+        .paint = paint_gradient_vertical, .cycle = 1,
+    },
+    {
+        .name = "Gradient R", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_channel, .cycle = 1,
+        .param_count = 1, .params = {{"channel", 0, 2, 0}},
+    },
+    {
+        .name = "Gradient G", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_channel, .cycle = 1,
+        .param_count = 1, .params = {{"channel", 0, 2, 1}},
+    },
+    {
+        .name = "Gradient B", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_channel, .cycle = 1,
+        .param_count = 1, .params = {{"channel", 0, 2, 2}},
+    },
+    {
+        .name = "Gradient D", .flags = 0,
+        .paint = paint_gradient_angled, .totals = gradient_angled_totals, .cycle = 1,
+        .param_count = 1, .params = {{"angle", 0, 359, 45}},
+    },
+    {
+        .name = "Gradient Rotate", .flags = PATTERN_ANIMATED,
+        .paint = paint_gradient_angled, .totals = gradient_angled_totals, .cycle = 360,
+        .param_count = 1, .params = {{"angle", 0, 359, 0}},
+    },
+    {
+        .name = "Gradient Radial", .flags = 0,
+        .paint = paint_gradient_radial, .cycle = 1,
+    },
+    {
+        .name = "Gradient Linear", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_linear, .cycle = 1,
+    },
+    {
+        .name = "Gradient L*", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_lstar, .cycle = 1,
+    },
+    {
+        .name = "Gradient Gamma", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gradient_gamma, .cycle = 1,
+        .param_count = 1, .params = {{"gamma", COLOR_GAMMA_MIN, COLOR_GAMMA_MAX, 22}},
+    },
+    {
+        .name = "Chroma Plane", .flags = 0,
+        .paint = paint_chroma_plane, .cycle = 1,
+        .param_count = 1, .params = {{"luma", 0, 255, 128}},
+    },
+    {
+        .name = "Checkerboard S", .flags = PATTERN_TILEABLE,
+        .paint = paint_checkerboard, .tile_size = checkerboard_tile_size, .cycle = 1,
+        .tile_width = 16, .tile_height = 16,
+        .param_count = 1, .params = {{"cell", 1, 128, 8}},
+    },
+    {
+        .name = "Checkerboard L", .flags = PATTERN_TILEABLE,
+        .paint = paint_checkerboard, .tile_size = checkerboard_tile_size, .cycle = 1,
+        .tile_width = 128, .tile_height = 128,
+        .param_count = 1, .params = {{"cell", 1, 128, 64}},
+    },
+    {
+        .name = "Bars H", .flags = PATTERN_COLUMNS_SAME,
+        .paint = paint_horizontal_bars, .cycle = 1,
+    },
+    {
+        .name = "Bars V", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_vertical_bars, .cycle = 1,
+    },
+    {
+        .name = "Moving Bar H", .flags = PATTERN_ANIMATED | PATTERN_ROWS_SAME,
+        .paint = paint_moving_bar_horizontal, .changed_rects = moving_bar_horizontal_changed,
+        .cycle = SCREEN_WIDTH + MOVING_BAR_SIZE,
+    },
+    {
+        .name = "Moving Bar V", .flags = PATTERN_ANIMATED | PATTERN_COLUMNS_SAME,
+        .paint = paint_moving_bar_vertical, .changed_rects = moving_bar_vertical_changed,
+        .cycle = SCREEN_HEIGHT + MOVING_BAR_SIZE,
+    },
+    {
+        .name = "Color Cycle", .flags = PATTERN_ANIMATED | SOLID_FLAGS,
+        .paint = paint_color_cycle, .solid_color = color_cycle_color,
+        .cycle = 360, .tile_width = 1, .tile_height = 1,
+    },
+    {
+        .name = "Hue Sweep", .flags = PATTERN_ANIMATED | PATTERN_ROWS_SAME,
+        .paint = paint_hue_sweep, .cycle = 360,
+    },
+    {
+        .name = "Inversion", .flags = PATTERN_ANIMATED | SOLID_FLAGS,
+        .paint = paint_inversion_test, .solid_color = inversion_color,
+        .cycle = 2, .hold = 60, .tile_width = 1, .tile_height = 1,
+    },
+    {
+        .name = "Gray Levels", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_gray_levels, .cycle = 1,
+        .param_count = 1, .params = {{"levels", 2, 64, 16}},
+    },
+    {
+        .name = "Grid", .flags = 0,
+        .paint = paint_grid, .cycle = 1,
+        .param_count = 1, .params = {{"cell", 4, 128, 32}},
+    },
+    {
+        .name = "Crosshatch", .flags = 0,
+        .paint = paint_crosshatch, .cycle = 1,
+        .param_count = 1, .params = {{"cell", 8, 128, 64}},
+    },
+    {
+        .name = "Convergence", .flags = 0,
+        .paint = paint_convergence, .cycle = 1,
+    },
+    {
+        .name = "Zone Plate", .flags = PATTERN_ANIMATED,
+        .paint = paint_zone_plate, .totals = zone_plate_totals, .cycle = 64,
+    },
+    {
+        .name = "Sine Grating", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_sine_grating, .cycle = 1,
+        .param_count = 1, .params = {{"period", 2, 64, 8}},
+    },
+    {
+        .name = "Sine Sweep", .flags = PATTERN_ROWS_SAME,
+        .paint = paint_sine_sweep, .cycle = 1,
+    },
+};
+
+#define REGISTRY_SIZE ((int)(sizeof(registry) / sizeof(registry[0])))
+
+_Static_assert(REGISTRY_SIZE <= PATTERN_MAX_COUNT, "raise PATTERN_MAX_COUNT");
+
+// Integer square root (floor)
+static uint32_t isqrt(uint32_t v) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+void pattern_init_tables(void) {
+    color_init_tables();
+    
+    // Distances in 1/16 pixel, so the center is 255 and the corners 0
+    uint32_t max_d = isqrt((uint32_t)RADIAL_MAX_D2 << 8);
+    for (int i = 0; i < (int)sizeof(radial_levels); i++) {
+        uint32_t d = isqrt(((uint32_t)i << RADIAL_SHIFT) << 8);
+        if (d > max_d) d = max_d;
+        radial_levels[i] = (uint8_t)(255 - (d * 255 + max_d / 2) / max_d);
+    }
+    
+    // Rotate a unit vector one degree at a time
+    double x = 1.0;
+    double y = 0.0;
+    const double cos1 = 0.99984769515639123916;
+    const double sin1 = 0.01745240643728351282;
+    for (int i = 0; i < 360; i++) {
+        sin_q16[i] = (int32_t)(y * 65536.0 + (y < 0 ? -0.5 : 0.5));
+        double nx = x * cos1 - y * sin1;
+        y = x * sin1 + y * cos1;
+        x = nx;
+    }
+}
+
+int pattern_count(void) {
+    return REGISTRY_SIZE;
+}
+
+const PatternDesc *pattern_get(int id) {
+    if (id < 0 || id >= REGISTRY_SIZE) return NULL;
+    return &registry[id];
+}
+
+void pattern_default_args(const PatternDesc *desc, PatternArgs *args) {
+    for (int i = 0; i < PATTERN_MAX_PARAMS; i++) {
+        args->v[i] = (i < desc->param_count) ? desc->params[i].def : 0;
+    }
+}
+
+void pattern_tile_size(const PatternDesc *desc, const PatternArgs *args, int *width, int *height) {
+    *width = desc->tile_width;
+    *height = desc->tile_height;
+    if (desc->tile_size) desc->tile_size(args, width, height);
+}
+
+static int gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int pattern_state(const PatternDesc *desc, int frame, int speed) {
+    if (!(desc->flags & PATTERN_ANIMATED)) return 0;
+    if (desc->hold > 0) return (frame / desc->hold) % desc->cycle;
+    return (frame * speed) % desc->cycle;
+}
+
+int pattern_state_count(const PatternDesc *desc, int speed) {
+    if (!(desc->flags & PATTERN_ANIMATED)) return 1;
+    if (desc->hold > 0) return desc->cycle;
+    return desc->cycle / gcd(speed, desc->cycle);
+}
+
+int pattern_period(const PatternDesc *desc, int speed) {
+    if (!(desc->flags & PATTERN_ANIMATED)) return 1;
+    if (desc->hold > 0) return desc->hold * desc->cycle;
+    return desc->cycle / gcd(speed, desc->cycle);
+}
+
+void pattern_render(uint32_t *pixels, const Rect *r, const PatternDesc *desc,
+                    const PatternArgs *args, int state) {
+    desc->paint(pixels, r, args, state);
+}
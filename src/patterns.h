@@ -0,0 +1,95 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include <stdint.h>
+#include "display.h"
+
+// Pattern registry.
+//
+// Every test pattern is described by a PatternDesc: how to paint it and
+// what the engine may assume about it. Caching, replication, strategy
+// selection and benchmarking all work from these flags instead of
+// special-casing individual patterns.
+//
+// Animated patterns step through `cycle` states; frames with the same
+// state render identically. A state either lasts `hold` frames, or (hold
+// 0) the state advances by the animation speed every frame.
+
+#define PATTERN_MAX_PARAMS 2
+#define PATTERN_MAX_COUNT  64   // Upper bound for per-pattern tables
+
+#define PATTERN_ANIMATED     (1 << 0)  // State changes over time
+#define PATTERN_SOLID        (1 << 1)  // Every pixel has one color per state
+#define PATTERN_ROWS_SAME    (1 << 2)  // All rows identical (varies along x only)
+#define PATTERN_COLUMNS_SAME (1 << 3)  // All columns identical (varies along y only)
+#define PATTERN_TILEABLE     (1 << 4)  // Repeats every tile_width x tile_height
+
+typedef struct {
+    const char *name;
+    int min;
+    int max;
+    int def;
+} PatternParam;
+
+typedef struct {
+    int v[PATTERN_MAX_PARAMS];
+} PatternArgs;
+
+struct PatternDesc;
+
+// Paint the part of the pattern inside r. pixels points at row 0 of a
+// buffer with SCREEN_FB_WIDTH pitch.
+typedef void (*PatternPaintFn)(uint32_t *pixels, const Rect *r, const PatternArgs *args, int state);
+
+// Color of a PATTERN_SOLID pattern in a state
+typedef uint32_t (*PatternColorFn)(const PatternArgs *args, int state);
+
+// Rects that differ between two states; returns the count or -1
+typedef int (*PatternChangedFn)(int old_state, int new_state, Rect *out, int max);
+
+// Per-channel (R, G, B) totals over the whole screen in closed form
+typedef void (*PatternTotalsFn)(const PatternArgs *args, int state, uint64_t totals[3]);
+
+// Tile size when it depends on the arguments
+typedef void (*PatternTileFn)(const PatternArgs *args, int *width, int *height);
+
+typedef struct PatternDesc {
+    const char *name;
+    uint32_t flags;
+    PatternPaintFn paint;
+    PatternColorFn solid_color;      // PATTERN_SOLID only
+    PatternChangedFn changed_rects;  // Optional, enables incremental repaint
+    PatternTotalsFn totals;          // Optional, saves rasterizing for APL
+    int cycle;                       // States per animation period (1 if static)
+    int hold;                        // Frames per state, 0 = advance by speed
+    int tile_width;                  // PATTERN_TILEABLE only
+    int tile_height;
+    PatternTileFn tile_size;         // Optional, overrides tile_width and tile_height
+    int param_count;
+    PatternParam params[PATTERN_MAX_PARAMS];
+} PatternDesc;
+
+// Build the lookup tables painters rely on; call once before rendering
+void pattern_init_tables(void);
+
+int pattern_count(void);
+const PatternDesc *pattern_get(int id);
+
+void pattern_default_args(const PatternDesc *desc, PatternArgs *args);
+
+// Tile size for the given arguments
+void pattern_tile_size(const PatternDesc *desc, const PatternArgs *args, int *width, int *height);
+
+// State shown at an animation frame (0 for static patterns)
+int pattern_state(const PatternDesc *desc, int frame, int speed);
+
+// Number of distinct states reachable at this speed
+int pattern_state_count(const PatternDesc *desc, int speed);
+
+// Frames until the animation repeats at this speed (1 for static patterns)
+int pattern_period(const PatternDesc *desc, int speed);
+
+void pattern_render(uint32_t *pixels, const Rect *r, const PatternDesc *desc,
+                    const PatternArgs *args, int state);
+
+#endif
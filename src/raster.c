@@ -0,0 +1,269 @@
+#include "raster.h"
+#include "span.h"
+
+#include <stdlib.h>
+
+void raster_hline(uint32_t *pixels, const Rect *clip, int x0, int x1, int y, uint32_t color) {
+    if (y < clip->y0 || y >= clip->y1) return;
+    if (x0 < clip->x0) x0 = clip->x0;
+    if (x1 > clip->x1) x1 = clip->x1;
+    if (x0 >= x1) return;
+    fill_span(pixels + y * SCREEN_FB_WIDTH + x0, color, x1 - x0);
+}
+
+void raster_vline(uint32_t *pixels, const Rect *clip, int x, int y0, int y1, uint32_t color) {
+    if (x < clip->x0 || x >= clip->x1) return;
+    if (y0 < clip->y0) y0 = clip->y0;
+    if (y1 > clip->y1) y1 = clip->y1;
+    for (int y = y0; y < y1; y++) {
+        pixels[y * SCREEN_FB_WIDTH + x] = color;
+    }
+}
+
+// Lines step along their major axis from the first endpoint; the minor
+// coordinate after k steps is m0 + sm * floor((2 * k * dm + dM) / (2 * dM)),
+// kept as a quotient and remainder so the walk can start at any k
+typedef struct {
+    int m;       // Minor coordinate
+    int sm;      // Its direction
+    int rem;
+    int step;    // 2 * dm
+    int limit;   // 2 * dM
+} LineWalk;
+
+static void walk_start(LineWalk *w, int m0, int sm, int dm, int dM, int k) {
+    int64_t n = 2 * (int64_t)k * dm + dM;
+    w->m = m0 + sm * (int)(n / (2 * dM));
+    w->sm = sm;
+    w->rem = (int)(n % (2 * dM));
+    w->step = 2 * dm;
+    w->limit = 2 * dM;
+}
+
+// Advance one step; returns 1 if the minor coordinate moved
+static inline int walk_step(LineWalk *w) {
+    w->rem += w->step;
+    if (w->rem < w->limit) return 0;
+    w->rem -= w->limit;
+    w->m += w->sm;
+    return 1;
+}
+
+// Steps k0..k1 of a line dM steps long starting at major coordinate M0
+// that fall inside [lo, hi); returns 0 if none do
+static int clip_steps(int M0, int dM, int lo, int hi, int *k0, int *k1) {
+    *k0 = lo - M0 > 0 ? lo - M0 : 0;
+    *k1 = hi - 1 - M0 < dM ? hi - 1 - M0 : dM;
+    return *k0 <= *k1;
+}
+
+void raster_line(uint32_t *pixels, const Rect *clip, int x0, int y0, int x1, int y1, uint32_t color) {
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    if (dx == 0 && dy == 0) {
+        raster_hline(pixels, clip, x0, x0 + 1, y0, color);
+        return;
+    }
+
+    LineWalk w;
+    int k0, k1;
+    if (dx >= dy) {
+        // One horizontal run per row
+        if (x0 > x1) {
+            int t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        if (!clip_steps(x0, dx, clip->x0, clip->x1, &k0, &k1)) return;
+        walk_start(&w, y0, y1 >= y0 ? 1 : -1, dy, dx, k0);
+        int run = x0 + k0;
+        for (int k = k0; k < k1; k++) {
+            int y = w.m;
+            if (walk_step(&w)) {
+                raster_hline(pixels, clip, run, x0 + k + 1, y, color);
+                run = x0 + k + 1;
+            }
+        }
+        raster_hline(pixels, clip, run, x0 + k1 + 1, w.m, color);
+    } else {
+        // One pixel per row
+        if (y0 > y1) {
+            int t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        if (!clip_steps(y0, dy, clip->y0, clip->y1, &k0, &k1)) return;
+        walk_start(&w, x0, x1 >= x0 ? 1 : -1, dx, dy, k0);
+        for (int k = k0; k <= k1; k++) {
+            if (w.m >= clip->x0 && w.m < clip->x1) pixels[(y0 + k) * SCREEN_FB_WIDTH + w.m] = color;
+            walk_step(&w);
+        }
+    }
+}
+
+// Mix color over *p with weight 0-256
+static inline void blend_pixel(uint32_t *p, uint32_t color, uint32_t weight) {
+    uint32_t d = *p;
+    uint32_t inv = 256 - weight;
+    uint32_t rb = (((color & 0xFF00FF) * weight + (d & 0xFF00FF) * inv) >> 8) & 0xFF00FF;
+    uint32_t g = (((color & 0x00FF00) * weight + (d & 0x00FF00) * inv) >> 8) & 0x00FF00;
+    *p = 0xFF000000 | rb | g;
+}
+
+static inline void plot_aa(uint32_t *pixels, const Rect *clip, int x, int y, uint32_t color, uint32_t weight) {
+    if (weight == 0 || x < clip->x0 || x >= clip->x1 || y < clip->y0 || y >= clip->y1) return;
+    blend_pixel(pixels + y * SCREEN_FB_WIDTH + x, color, weight);
+}
+
+void raster_line_aa(uint32_t *pixels, const Rect *clip, int x0, int y0, int x1, int y1, uint32_t color) {
+    int steep = abs(y1 - y0) > abs(x1 - x0);
+    // Major and minor coordinates of both ends
+    int M0 = steep ? y0 : x0;
+    int m0 = steep ? x0 : y0;
+    int M1 = steep ? y1 : x1;
+    int m1 = steep ? x1 : y1;
+    if (M0 > M1) {
+        int t = M0; M0 = M1; M1 = t;
+        t = m0; m0 = m1; m1 = t;
+    }
+    int dM = M1 - M0;
+    if (dM == 0) {
+        raster_hline(pixels, clip, x0, x0 + 1, y0, color);
+        return;
+    }
+
+    int k0, k1;
+    if (!clip_steps(M0, dM, steep ? clip->y0 : clip->x0, steep ? clip->y1 : clip->x1, &k0, &k1)) return;
+
+    // Minor coordinate in 16.16 fixed point
+    int32_t gradient = (int32_t)((int64_t)(m1 - m0) * 65536 / dM);
+    int32_t pos = (int32_t)((int64_t)m0 * 65536 + (int64_t)k0 * gradient);
+    for (int k = k0; k <= k1; k++) {
+        int m = pos >> 16;
+        uint32_t frac = ((uint32_t)pos >> 8) & 0xFF;
+        if (steep) {
+            plot_aa(pixels, clip, m, M0 + k, color, 256 - frac);
+            plot_aa(pixels, clip, m + 1, M0 + k, color, frac);
+        } else {
+            plot_aa(pixels, clip, M0 + k, m, color, 256 - frac);
+            plot_aa(pixels, clip, M0 + k, m + 1, color, frac);
+        }
+        pos += gradient;
+    }
+}
+
+void raster_polyline(uint32_t *pixels, const Rect *clip, const RasterPoint *points, int count,
+                     uint32_t color) {
+    for (int i = 1; i < count; i++) {
+        raster_line(pixels, clip, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y, color);
+    }
+    if (count == 1) raster_hline(pixels, clip, points[0].x, points[0].x + 1, points[0].y, color);
+}
+
+// Rows cy - dy and cy + dy of an ellipse whose half width on this row is
+// x and on the next row out was outer (-1 past the top). An outline row
+// runs from where the next row out ended to x, so it stays connected.
+static void ellipse_row(uint32_t *pixels, const Rect *clip, int cx, int cy, int dy,
+                        int x, int outer, int fill, uint32_t color) {
+    int inner = fill ? 0 : (outer + 1 < x ? outer + 1 : x);
+    for (int side = 0; side < (dy ? 2 : 1); side++) {
+        int y = side ? cy - dy : cy + dy;
+        if (y < clip->y0 || y >= clip->y1) continue;
+        if (inner == 0) {
+            raster_hline(pixels, clip, cx - x, cx + x + 1, y, color);
+        } else {
+            raster_hline(pixels, clip, cx - x, cx - inner + 1, y, color);
+            raster_hline(pixels, clip, cx + inner, cx + x + 1, y, color);
+        }
+    }
+}
+
+// Midpoint ellipse walk over the first quadrant from (0, ry) to (rx, 0),
+// emitting each row once its widest point is known. Decision values are
+// scaled by 4 to stay integral.
+static void ellipse_walk(uint32_t *pixels, const Rect *clip, int cx, int cy, int rx, int ry,
+                         int fill, uint32_t color) {
+    if (rx < 0 || ry < 0) return;
+    if (rx == 0 || ry == 0) {
+        raster_hline(pixels, clip, cx - rx, cx + rx + 1, cy, color);
+        raster_vline(pixels, clip, cx, cy - ry, cy + ry + 1, color);
+        return;
+    }
+    // Nothing to draw if the bounding box misses the clip
+    if (cy - ry >= clip->y1 || cy + ry < clip->y0 || cx - rx >= clip->x1 || cx + rx < clip->x0) return;
+
+    int64_t a2 = (int64_t)rx * rx;
+    int64_t b2 = (int64_t)ry * ry;
+    int64_t px = 0;
+    int64_t py = 2 * a2 * ry;
+    int x = 0;
+    int y = ry;
+    int outer = -1;
+
+    // Region 1: slope above -1, x advances every step
+    int64_t p = 4 * b2 - 4 * a2 * ry + a2;
+    while (px < py) {
+        x++;
+        px += 2 * b2;
+        if (p < 0) {
+            p += 4 * (b2 + px);
+        } else {
+            ellipse_row(pixels, clip, cx, cy, y, x - 1, outer, fill, color);
+            outer = x - 1;
+            y--;
+            py -= 2 * a2;
+            p += 4 * (b2 + px - py);
+        }
+    }
+
+    // Region 2: y advances every step
+    p = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (int64_t)(y - 1) * (y - 1) - 4 * a2 * b2;
+    while (y >= 0) {
+        ellipse_row(pixels, clip, cx, cy, y, x, outer, fill, color);
+        outer = x;
+        y--;
+        py -= 2 * a2;
+        if (p > 0) {
+            p += 4 * (a2 - py);
+        } else {
+            x++;
+            px += 2 * b2;
+            p += 4 * (a2 - py + px);
+        }
+    }
+}
+
+void raster_ellipse(uint32_t *pixels, const Rect *clip, int cx, int cy, int rx, int ry, uint32_t color) {
+    ellipse_walk(pixels, clip, cx, cy, rx, ry, 0, color);
+}
+
+void raster_fill_ellipse(uint32_t *pixels, const Rect *clip, int cx, int cy, int rx, int ry, uint32_t color) {
+    ellipse_walk(pixels, clip, cx, cy, rx, ry, 1, color);
+}
+
+void raster_grid(uint32_t *pixels, const Rect *clip, const Rect *area, int step_x, int step_y,
+                 int width, uint32_t color) {
+    Rect r = *area;
+    if (r.x0 < clip->x0) r.x0 = clip->x0;
+    if (r.y0 < clip->y0) r.y0 = clip->y0;
+    if (r.x1 > clip->x1) r.x1 = clip->x1;
+    if (r.y1 > clip->y1) r.y1 = clip->y1;
+    if (r.x0 >= r.x1 || r.y0 >= r.y1 || step_x <= 0 || step_y <= 0 || width <= 0) return;
+
+    int first = area->x0 + (r.x0 - area->x0) / step_x * step_x;
+    int right = area->x1 - width;
+    for (int y = r.y0; y < r.y1; y++) {
+        uint32_t *row = pixels + y * SCREEN_FB_WIDTH;
+        if ((y - area->y0) % step_y < width || y >= area->y1 - width) {
+            fill_span(row + r.x0, color, r.x1 - r.x0);
+            continue;
+        }
+        for (int x = first; x < r.x1; x += step_x) {
+            int x0 = x > r.x0 ? x : r.x0;
+            int x1 = x + width < r.x1 ? x + width : r.x1;
+            if (x0 < x1) fill_span(row + x0, color, x1 - x0);
+        }
+        if (right < r.x1) {
+            int x0 = right > r.x0 ? right : r.x0;
+            fill_span(row + x0, color, r.x1 - x0);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdint.h>
+#include "display.h"
+
+// Vector rasterizer for geometry patterns and overlays.
+//
+// Every primitive is walked with integer error terms (Bresenham and
+// midpoint algorithms, no per-pixel trig or square roots) and written as
+// horizontal spans with fill_span, so drawing cost follows the number of
+// rows touched rather than the number of pixels. Drawing is clipped to
+// `clip`, which a pattern painter passes its repaint rect as; long lines
+// start their walk at the clip edge. pixels points at row 0 of a buffer
+// with SCREEN_FB_WIDTH pitch and clip must lie inside the screen.
+
+typedef struct {
+    int x, y;
+} RasterPoint;
+
+// Pixels [x0, x1) of row y
+void raster_hline(uint32_t *pixels, const Rect *clip, int x0, int x1, int y, uint32_t color);
+
+// Pixels [y0, y1) of column x
+void raster_vline(uint32_t *pixels, const Rect *clip, int x, int y0, int y1, uint32_t color);
+
+// Line between two pixels, both included
+void raster_line(uint32_t *pixels, const Rect *clip, int x0, int y0, int x1, int y1, uint32_t color);
+
+// Anti-aliased line (Xiaolin Wu): each step along the major axis covers
+// the two nearest pixels, blended over what is there by distance
+void raster_line_aa(uint32_t *pixels, const Rect *clip, int x0, int y0, int x1, int y1, uint32_t color);
+
+// Connected lines through count points
+void raster_polyline(uint32_t *pixels, const Rect *clip, const RasterPoint *points, int count,
+                     uint32_t color);
+
+// One pixel wide ellipse outline with radii rx and ry around (cx, cy)
+void raster_ellipse(uint32_t *pixels, const Rect *clip, int cx, int cy, int rx, int ry, uint32_t color);
+
+// Filled ellipse, one span per row
+void raster_fill_ellipse(uint32_t *pixels, const Rect *clip, int cx, int cy, int rx, int ry, uint32_t color);
+
+static inline void raster_circle(uint32_t *pixels, const Rect *clip, int cx, int cy, int r, uint32_t color) {
+    raster_ellipse(pixels, clip, cx, cy, r, r, color);
+}
+
+// Lines `width` pixels wide every step_x columns and step_y rows of area,
+// starting at its top left corner, plus lines along its right and bottom
+// edges so the grid is closed
+void raster_grid(uint32_t *pixels, const Rect *clip, const Rect *area, int step_x, int step_y,
+                 int width, uint32_t color);
+
+#endif
@@ -0,0 +1,105 @@
+#include "rle.h"
+#include "span.h"
+
+#include <string.h>
+
+// Only the most recent unique rows are considered for sharing; this keeps
+// encoding linear while still catching bars, stripes and checkerboards
+#define RLE_DEDUP_WINDOW 16
+
+size_t rle_encode(const uint32_t *src, int width, int height, int pitch,
+                  void *out, size_t capacity) {
+    uint8_t *base = (uint8_t *)out;
+    size_t runs_offset = rle_runs_offset(height);
+    if (width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF) return 0;
+    if (capacity < runs_offset) return 0;
+
+    RleFrame *frame = (RleFrame *)base;
+    uint16_t *row_list = (uint16_t *)(frame + 1);
+    RleRun *runs = (RleRun *)(base + runs_offset);
+
+    // Unique row lists are collected at the end of the output buffer and
+    // moved behind the runs once their count is known
+    RleRowList *lists = (RleRowList *)(base + (capacity & ~(size_t)7));
+    uint32_t run_count = 0;
+    uint32_t list_count = 0;
+
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = src + y * pitch;
+        uint32_t first = run_count;
+
+        int x = 0;
+        while (x < width) {
+            uint32_t color = row[x];
+            int start = x;
+            while (x < width && row[x] == color) x++;
+
+            if ((uint8_t *)(runs + run_count + 1) > (uint8_t *)(lists - 1)) return 0;
+            runs[run_count].color = color;
+            runs[run_count].length = x - start;
+            run_count++;
+        }
+
+        uint32_t count = run_count - first;
+        int match = -1;
+        for (uint32_t i = 0; i < list_count && i < RLE_DEDUP_WINDOW; i++) {
+            // lists grows downward, so lists[i] is the i-th most recent row list
+            if (lists[i].run_count == count &&
+                memcmp(&runs[lists[i].first_run], &runs[first], count * sizeof(RleRun)) == 0) {
+                match = list_count - 1 - i;
+                break;
+            }
+        }
+
+        if (match >= 0) {
+            run_count = first;
+            row_list[y] = (uint16_t)match;
+        } else {
+            if (list_count >= 0xFFFF) return 0;
+            lists--;
+            lists[0].first_run = first;
+            lists[0].run_count = count;
+            row_list[y] = (uint16_t)list_count;
+            list_count++;
+        }
+    }
+
+    // Restore creation order, then move the row lists behind the runs
+    for (uint32_t i = 0; i < list_count / 2; i++) {
+        RleRowList tmp = lists[i];
+        lists[i] = lists[list_count - 1 - i];
+        lists[list_count - 1 - i] = tmp;
+    }
+    RleRowList *dst_lists = (RleRowList *)(runs + run_count);
+    memmove(dst_lists, lists, list_count * sizeof(RleRowList));
+
+    frame->width = (uint16_t)width;
+    frame->height = (uint16_t)height;
+    frame->list_count = list_count;
+    frame->run_count = run_count;
+    frame->size = (uint32_t)((uint8_t *)(dst_lists + list_count) - base);
+    return frame->size;
+}
+
+void rle_decode_rows(const RleFrame *frame, uint32_t *dst, int pitch, int y0, int y1) {
+    const uint16_t *row_list = rle_row_lists(frame);
+    const RleRowList *lists = rle_lists(frame);
+    const RleRun *runs = rle_runs(frame);
+
+    if (y0 < 0) y0 = 0;
+    if (y1 > frame->height) y1 = frame->height;
+
+    for (int y = y0; y < y1; y++) {
+        const RleRowList *list = &lists[row_list[y]];
+        const RleRun *run = runs + list->first_run;
+        uint32_t *out = dst + y * pitch;
+        for (uint32_t i = 0; i < list->run_count; i++) {
+            fill_span(out, run[i].color, run[i].length);
+            out += run[i].length;
+        }
+    }
+}
+
+void rle_decode(const RleFrame *frame, uint32_t *dst, int pitch) {
+    rle_decode_rows(frame, dst, pitch, 0, frame->height);
+}
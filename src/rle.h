@@ -0,0 +1,61 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Run-length frame format.
+//
+// A frame is a table of unique row lists plus one list index per row, so
+// rows that repeat (bars, checkerboards, gradients) are stored once. Each
+// row list is a sequence of runs whose lengths add up to the frame width.
+// The whole frame lives in one contiguous, position-independent blob:
+//
+//   RleFrame | uint16_t row_list[height] | RleRun runs[] | RleRowList lists[]
+
+typedef struct {
+    uint32_t color;
+    uint32_t length;
+} RleRun;
+
+typedef struct {
+    uint32_t first_run;
+    uint32_t run_count;
+} RleRowList;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint32_t size;          // Size of the whole blob in bytes
+    uint32_t list_count;
+    uint32_t run_count;
+} RleFrame;
+
+// Encode width x height pixels of src (pitch in pixels). Returns the blob
+// size, or 0 if it would not fit in capacity bytes (out is then unusable).
+size_t rle_encode(const uint32_t *src, int width, int height, int pitch,
+                  void *out, size_t capacity);
+
+// Expand a frame into dst (pitch in pixels)
+void rle_decode(const RleFrame *frame, uint32_t *dst, int pitch);
+
+// Expand rows [y0, y1) of a frame into dst, which points at row 0
+void rle_decode_rows(const RleFrame *frame, uint32_t *dst, int pitch, int y0, int y1);
+
+static inline const uint16_t *rle_row_lists(const RleFrame *frame) {
+    return (const uint16_t *)(frame + 1);
+}
+
+static inline size_t rle_runs_offset(int height) {
+    return sizeof(RleFrame) + ((height * sizeof(uint16_t) + 7) & ~(size_t)7);
+}
+
+static inline const RleRun *rle_runs(const RleFrame *frame) {
+    return (const RleRun *)((const uint8_t *)frame + rle_runs_offset(frame->height));
+}
+
+static inline const RleRowList *rle_lists(const RleFrame *frame) {
+    return (const RleRowList *)(rle_runs(frame) + frame->run_count);
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "scheduler.h"
+#include "display.h"
+#include "evlog.h"
+
+#include <psp2/display.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define MARGIN_MIN_US   1000
+#define MARGIN_MAX_US   8000
+#define MARGIN_STEP_US  1000
+#define MARGIN_DECAY_US 100
+#define MARGIN_DECAY_FRAMES 120     // On-time frames between margin reductions
+#define RATE_WINDOW_US  1000000
+
+static int enabled = 1;
+static SchedulerStats stats = {.margin_us = MARGIN_MIN_US + MARGIN_STEP_US};
+
+static uint64_t last_vblank = 0;     // 0 until the first flip
+static uint64_t latch_time = 0;      // 0 outside a frame
+static uint64_t target_vblank = 0;
+static uint32_t cost_avg = 0;        // Smoothed render cost
+static uint32_t cost_peak = 0;       // Slowly decaying maximum
+static uint32_t on_time = 0;
+
+static int divisor = 1;
+static int last_vcount = -1;         // Vblank last waited for, -1 if unknown
+static int latch_vcount = -1;        // Vcount at the last latch, -1 if unknown
+static int latch_vblanks = 1;
+static uint64_t rate_start = 0;      // Start of the flip rate window, 0 if none
+static uint32_t rate_flips = 0;
+
+void scheduler_set_enabled(int on) {
+    enabled = on;
+    evlog_printf("scheduler: late latching %s", on ? "on" : "off");
+}
+
+int scheduler_enabled(void) {
+    return enabled;
+}
+
+void scheduler_set_divisor(int d) {
+    divisor = d < 1 ? 1 : (d > SCHEDULER_MAX_DIVISOR ? SCHEDULER_MAX_DIVISOR : d);
+    evlog_printf("scheduler: refresh divisor %d (%d Hz)", divisor, 60 / divisor);
+}
+
+int scheduler_divisor(void) {
+    return divisor;
+}
+
+static uint32_t predict(void) {
+    uint32_t cost = cost_avg > cost_peak ? cost_avg : cost_peak;
+    return cost + stats.margin_us;
+}
+
+// First vblank at or after t
+static uint64_t vblank_after(uint64_t t) {
+    if (t <= last_vblank) return last_vblank;
+    uint64_t periods = (t - last_vblank + SCREEN_REFRESH_US - 1) / SCREEN_REFRESH_US;
+    return last_vblank + periods * SCREEN_REFRESH_US;
+}
+
+void scheduler_latch(void) {
+    uint64_t now = sceKernelGetProcessTimeWide();
+    stats.predicted_us = predict();
+    target_vblank = 0;
+    
+    if (enabled && last_vblank != 0) {
+        uint64_t due = last_vblank + (uint64_t)divisor * SCREEN_REFRESH_US;
+        uint64_t ready = now + stats.predicted_us;
+        target_vblank = vblank_after(ready > due ? ready : due);
+        uint64_t latch_at = target_vblank - stats.predicted_us;
+        if (latch_at > now) {
+            sceKernelDelayThread((SceUInt)(latch_at - now));
+            now = sceKernelGetProcessTimeWide();
+        }
+    }
+    latch_time = now;
+    
+    // Vcount differences stay small, so 16 bits are enough
+    int vcount = sceDisplayGetVcount();
+    latch_vblanks = latch_vcount < 0 ? divisor : (uint16_t)(vcount - latch_vcount);
+    latch_vcount = vcount;
+}
+
+int scheduler_latched_vblanks(void) {
+    return latch_vblanks;
+}
+
+void scheduler_render_done(void) {
+    if (latch_time == 0) return;
+    uint32_t cost = (uint32_t)(sceKernelGetProcessTimeWide() - latch_time);
+    cost_avg = cost_avg ? (cost_avg * 7 + cost) / 8 : cost;
+    cost_peak -= cost_peak / 64;
+    if (cost > cost_peak) cost_peak = cost;
+}
+
+void scheduler_wait_vblank(void) {
+    int wait = 1;
+    if (divisor > 1 && last_vcount >= 0) {
+        // Vcount differences stay small, so 16 bits are enough
+        int16_t due = (int16_t)(uint16_t)(last_vcount + divisor - sceDisplayGetVcount());
+        if (due > 1) wait = due;
+    }
+    sceDisplayWaitVblankStartMulti(wait);
+    last_vcount = sceDisplayGetVcount();
+}
+
+// Count a vblank that ended a frame towards the flip rate
+static void count_rate(uint64_t vblank_time, int flipped) {
+    if (rate_start == 0) {
+        rate_start = vblank_time;
+        rate_flips = 0;
+        return;
+    }
+    rate_flips += flipped;
+    uint64_t elapsed = vblank_time - rate_start;
+    if (elapsed >= RATE_WINDOW_US) {
+        stats.rate_x100 = (uint32_t)((uint64_t)rate_flips * 100 * 1000000 / elapsed);
+        rate_start = vblank_time;
+        rate_flips = 0;
+    }
+}
+
+void scheduler_held(uint64_t vblank_time) {
+    last_vblank = vblank_time;
+    latch_time = 0;
+    stats.held++;
+    count_rate(vblank_time, 0);
+}
+
+void scheduler_flipped(uint64_t vblank_time) {
+    last_vblank = vblank_time;
+    count_rate(vblank_time, 1);
+    if (latch_time == 0) return;
+    
+    uint32_t latency = (uint32_t)(vblank_time - latch_time);
+    stats.last_latency_us = latency;
+    stats.latency_us = stats.frames ? (stats.latency_us * 7 + latency) / 8 : latency;
+    stats.frames++;
+    latch_time = 0;
+    
+    if (target_vblank == 0) return;
+    if (vblank_time > target_vblank + SCREEN_REFRESH_US / 2) {
+        stats.misses++;
+        on_time = 0;
+        if (stats.margin_us < MARGIN_MAX_US) stats.margin_us += MARGIN_STEP_US;
+        evlog_printf("scheduler: missed vblank, latency %u us, predicted %u us, margin now %u us",
+                     (unsigned)latency, (unsigned)stats.predicted_us, (unsigned)stats.margin_us);
+    } else if (++on_time >= MARGIN_DECAY_FRAMES) {
+        on_time = 0;
+        if (stats.margin_us > MARGIN_MIN_US) stats.margin_us -= MARGIN_DECAY_US;
+    }
+}
+
+void scheduler_resync(void) {
+    last_vblank = 0;
+    target_vblank = 0;
+    last_vcount = -1;
+    latch_vcount = sceDisplayGetVcount();
+    latch_vblanks = divisor;
+    rate_start = 0;
+    if (latch_time != 0) latch_time = sceKernelGetProcessTimeWide();
+}
+
+const SchedulerStats *scheduler_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,70 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Late-latching frame scheduler.
+//
+// Instead of sampling input right after a flip and then idling in the
+// vblank wait, the main loop sleeps until only the predicted render time
+// (plus a safety margin) is left before the next vblank, and samples input
+// then. The prediction follows recent render costs; a missed vblank widens
+// the margin, which then shrinks back while frames keep landing on time.
+//
+// With a refresh divisor above 1 new frames are shown only every
+// `divisor` vblanks (30, 20 or 15 Hz) and the CPU sleeps in between. A
+// frame the screen already shows is held instead of flipped again, and
+// the achieved flip rate is measured so the saving can be weighed
+// against motion smoothness.
+
+#define SCHEDULER_MAX_DIVISOR 4
+
+typedef struct {
+    uint32_t predicted_us;    // Render time reserved before the target vblank
+    uint32_t margin_us;       // Safety margin included in predicted_us
+    uint32_t latency_us;      // Smoothed input-sample-to-flip latency
+    uint32_t last_latency_us;
+    uint32_t frames;
+    uint32_t misses;          // Frames that flipped later than their target vblank
+    uint32_t held;            // Frames held because the screen already showed them
+    uint32_t rate_x100;       // Flips per second over the last second, x100
+} SchedulerStats;
+
+void scheduler_set_enabled(int enabled);
+int scheduler_enabled(void);
+
+// Show new frames every `divisor` vblanks (1 to SCHEDULER_MAX_DIVISOR)
+void scheduler_set_divisor(int divisor);
+int scheduler_divisor(void);
+
+// Sleep until it is time to sample input and render; call at the top of
+// the frame. Returns immediately when late latching is disabled.
+void scheduler_latch(void);
+
+// Vblanks between the last two latches: how far the frame in progress is
+// ahead of the previous one, held or missed vblanks included
+int scheduler_latched_vblanks(void);
+
+// Call once the frame is fully drawn, before waiting for vblank
+void scheduler_render_done(void);
+
+// Wait for the vblank the frame in progress is due at: `divisor` vblanks
+// after the last one waited for, or the next one if that has passed
+void scheduler_wait_vblank(void);
+
+// Call right after the flip with the time the vblank was reached
+void scheduler_flipped(uint64_t vblank_time);
+
+// Call instead of scheduler_flipped() when the frame was not flipped
+// because the screen already showed it
+void scheduler_held(uint64_t vblank_time);
+
+// The frame in progress was held up by something outside the app (a
+// system suspend): restart its timing now and pick up the vblank phase
+// again from the next flip, so neither counts as a miss or a slow render
+// (and the frame steps on by `divisor` vblanks, not the time asleep)
+void scheduler_resync(void);
+
+const SchedulerStats *scheduler_stats(void);
+
+#endif
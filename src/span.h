@@ -0,0 +1,110 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Fill count pixels starting at dst with color
+static inline void fill_span(uint32_t *dst, uint32_t color, int count) {
+#if defined(__ARM_NEON)
+    uint32x4_t v = vdupq_n_u32(color);
+    while (count >= 16) {
+        vst1q_u32(dst, v);
+        vst1q_u32(dst + 4, v);
+        vst1q_u32(dst + 8, v);
+        vst1q_u32(dst + 12, v);
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        vst1q_u32(dst, v);
+        dst += 4;
+        count -= 4;
+    }
+#endif
+    while (count-- > 0) {
+        *dst++ = color;
+    }
+}
+
+// Write count pixels whose level follows the 16.16 fixed-point ramp
+// v, v + step, v + 2 * step, ... clamped to 0-255 and multiplied into the
+// channels set in mul (0x010101 for gray, 0x000001 for red only)
+static inline void ramp_span(uint32_t *dst, int count, int32_t v, int32_t step, uint32_t mul) {
+#if defined(__ARM_NEON)
+    const int32_t start[4] = {v, v + step, v + 2 * step, v + 3 * step};
+    int32x4_t level_fx = vld1q_s32(start);
+    int32x4_t step4 = vdupq_n_s32(4 * step);
+    int32x4_t lo = vdupq_n_s32(0);
+    int32x4_t hi = vdupq_n_s32(255);
+    uint32x4_t channels = vdupq_n_u32(mul);
+    uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+    while (count >= 4) {
+        int32x4_t level = vminq_s32(vmaxq_s32(vshrq_n_s32(level_fx, 16), lo), hi);
+        vst1q_u32(dst, vmlaq_u32(alpha, vreinterpretq_u32_s32(level), channels));
+        level_fx = vaddq_s32(level_fx, step4);
+        dst += 4;
+        count -= 4;
+    }
+    v = vgetq_lane_s32(level_fx, 0);
+#endif
+    while (count-- > 0) {
+        int32_t level = v >> 16;
+        if (level < 0) level = 0;
+        if (level > 255) level = 255;
+        *dst++ = 0xFF000000 | ((uint32_t)level * mul);
+        v += step;
+    }
+}
+
+// Add the per-channel sums (R, G, B) of count pixels to sums. count must
+// not exceed 2048 so the 16-bit NEON accumulators cannot overflow.
+static inline void sum_span(const uint32_t *src, int count, uint32_t sums[3]) {
+#if defined(__ARM_NEON)
+    uint16x8_t r = vdupq_n_u16(0);
+    uint16x8_t g = r;
+    uint16x8_t b = r;
+    while (count >= 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t *)src);
+        r = vaddw_u8(r, px.val[0]);
+        g = vaddw_u8(g, px.val[1]);
+        b = vaddw_u8(b, px.val[2]);
+        src += 8;
+        count -= 8;
+    }
+    uint64x2_t r64 = vpaddlq_u32(vpaddlq_u16(r));
+    uint64x2_t g64 = vpaddlq_u32(vpaddlq_u16(g));
+    uint64x2_t b64 = vpaddlq_u32(vpaddlq_u16(b));
+    sums[0] += (uint32_t)(vgetq_lane_u64(r64, 0) + vgetq_lane_u64(r64, 1));
+    sums[1] += (uint32_t)(vgetq_lane_u64(g64, 0) + vgetq_lane_u64(g64, 1));
+    sums[2] += (uint32_t)(vgetq_lane_u64(b64, 0) + vgetq_lane_u64(b64, 1));
+#endif
+    while (count-- > 0) {
+        uint32_t p = *src++;
+        sums[0] += p & 0xFF;
+        sums[1] += (p >> 8) & 0xFF;
+        sums[2] += (p >> 16) & 0xFF;
+    }
+}
+
+// Fold count words into a Fletcher-style running checksum. sum[0] and
+// sum[1] start at 0; combine them with checksum_value() at the end.
+static inline void checksum_span(const uint32_t *src, int count, uint32_t sum[2]) {
+    uint32_t a = sum[0];
+    uint32_t b = sum[1];
+    while (count-- > 0) {
+        a += *src++;
+        b += a;
+    }
+    sum[0] = a;
+    sum[1] = b;
+}
+
+static inline uint64_t checksum_value(const uint32_t sum[2]) {
+    return ((uint64_t)sum[1] << 32) | sum[0];
+}
+
+#endif
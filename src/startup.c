@@ -0,0 +1,106 @@
+#include "startup.h"
+#include "evlog.h"
+
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define MAX_STARTUP_TASKS 16
+
+typedef struct {
+    const char *name;
+    StartupTask run;
+} StartupEntry;
+
+static StartupEntry tasks[MAX_STARTUP_TASKS];
+static int task_count = 0;
+
+static SceUID worker_thread = -1;
+static SceUID done_sema = -1;
+static volatile int ready = 0;
+
+static uint64_t first_frame_time = 0;
+static uint64_t ready_time = 0;
+
+void startup_add_task(const char *name, StartupTask task) {
+    if (task_count >= MAX_STARTUP_TASKS) {
+        evlog_printf("startup: task table full, '%s' not run", name);
+        return;
+    }
+    tasks[task_count].name = name;
+    tasks[task_count].run = task;
+    task_count++;
+}
+
+void startup_mark_first_frame(void) {
+    if (first_frame_time == 0) {
+        first_frame_time = sceKernelGetProcessTimeWide();
+    }
+}
+
+static void finish(void) {
+    ready_time = sceKernelGetProcessTimeWide();
+    __atomic_store_n(&ready, 1, __ATOMIC_RELEASE);
+
+    evlog_printf("startup: first frame %u us, ready %u us (%d tasks)",
+                 (unsigned)first_frame_time, (unsigned)ready_time, task_count);
+    evlog_flush();
+}
+
+static int startup_thread(SceSize args, void *argp) {
+    (void)args;
+    (void)argp;
+
+    for (int i = 0; i < task_count; i++) {
+        uint64_t start = sceKernelGetProcessTimeWide();
+        tasks[i].run();
+        uint64_t took = sceKernelGetProcessTimeWide() - start;
+        evlog_printf("startup: task '%s' took %u us", tasks[i].name, (unsigned)took);
+    }
+
+    finish();
+    sceKernelSignalSema(done_sema, 1);
+    return 0;
+}
+
+void startup_run_background(void) {
+    done_sema = sceKernelCreateSema("startup_done", 0, 0, 1, NULL);
+
+    // Run on the second user core so the main thread keeps presenting
+    worker_thread = sceKernelCreateThread("startup", startup_thread,
+                                          SCE_KERNEL_DEFAULT_PRIORITY_USER, 0x10000, 0,
+                                          SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (worker_thread < 0 || done_sema < 0) {
+        // No thread available: do the work inline rather than not at all
+        if (worker_thread >= 0) sceKernelDeleteThread(worker_thread);
+        if (done_sema >= 0) sceKernelDeleteSema(done_sema);
+        worker_thread = -1;
+        done_sema = -1;
+        startup_thread(0, NULL);
+        return;
+    }
+    sceKernelStartThread(worker_thread, 0, NULL);
+}
+
+int startup_is_ready(void) {
+    return __atomic_load_n(&ready, __ATOMIC_ACQUIRE);
+}
+
+void startup_wait_ready(void) {
+    if (worker_thread < 0) return;
+    
+    // The worker exits right after signalling, so reap it with its semaphore
+    sceKernelWaitSema(done_sema, 1, NULL);
+    sceKernelWaitThreadEnd(worker_thread, NULL, NULL);
+    sceKernelDeleteThread(worker_thread);
+    sceKernelDeleteSema(done_sema);
+    worker_thread = -1;
+    done_sema = -1;
+}
+
+uint64_t startup_time_to_first_frame(void) {
+    return first_frame_time;
+}
+
+uint64_t startup_time_to_ready(void) {
+    return ready_time;
+}
@@ -0,0 +1,32 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+
+// Staged startup: main() presents a minimal first frame as early as
+// possible, then heavy initialization (caches, LUTs, file I/O) runs as
+// registered tasks on a background thread while the welcome screen is up.
+
+typedef void (*StartupTask)(void);
+
+// Register a task before startup_run_background(). Tasks run in order;
+// the table holds 16, tasks past that are logged and dropped.
+void startup_add_task(const char *name, StartupTask task);
+
+// Call right after the first frame has been handed to the display
+void startup_mark_first_frame(void);
+
+// Start the background thread that runs all registered tasks
+void startup_run_background(void);
+
+int startup_is_ready(void);
+
+// Block until every task has finished, then delete the worker thread
+// (returns immediately once that is done)
+void startup_wait_ready(void);
+
+// Microseconds since process start; 0 until the milestone is reached
+uint64_t startup_time_to_first_frame(void);
+uint64_t startup_time_to_ready(void);
+
+#endif
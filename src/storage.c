@@ -0,0 +1,14 @@
+#include "storage.h"
+
+#include <psp2/io/stat.h>
+#include <stdio.h>
+
+void storage_ensure_dir(void) {
+    // Errors are ignored: the directory usually exists already
+    sceIoMkdir("ux0:data", 0777);
+    sceIoMkdir(APP_DATA_DIR, 0777);
+}
+
+void storage_path(char *buf, size_t size, const char *name) {
+    snprintf(buf, size, "%s/%s", APP_DATA_DIR, name);
+}
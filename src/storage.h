@@ -0,0 +1,15 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+
+// All persistent files (logs, maps, dumps) live under this directory
+#define APP_DATA_DIR "ux0:data/VitaScreenTest"
+
+// Create APP_DATA_DIR if it does not exist yet
+void storage_ensure_dir(void);
+
+// Build "APP_DATA_DIR/name" into buf
+void storage_path(char *buf, size_t size, const char *name);
+
+#endif
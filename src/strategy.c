@@ -0,0 +1,341 @@
+#include "strategy.h"
+#include "bands.h"
+#include "evlog.h"
+#include "frame_cache.h"
+#include "span.h"
+
+#include <psp2/kernel/processmgr.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every applicable strategy is tried this many times before choosing
+#define MIN_SAMPLES 3
+
+// Patterns with more states than this are not worth caching
+#define MAX_CACHED_STATES 8
+
+// Tallest tile band that row replication keeps in LPDDR
+#define MAX_BAND_ROWS 16
+
+#define MAX_OVERLAY_RECTS 4
+#define MAX_CHANGED_RECTS (STRATEGY_MAX_REPAINTED - MAX_OVERLAY_RECTS)
+
+typedef struct {
+    int valid;
+    int pattern;
+    PatternArgs args;
+    int state;
+    Rect overlays[MAX_OVERLAY_RECTS];
+    int overlay_count;
+    uint64_t fingerprint;    // Checksum of the pixels, valid while fingerprinted
+    int fingerprinted;
+} BufferContent;
+
+static BufferContent buffers[2];
+static StrategyStats stats[PATTERN_MAX_COUNT][STRATEGY_COUNT];
+static uint8_t cache_failed[PATTERN_MAX_COUNT];    // Does not fit the frame cache (kept by strategy_init)
+static uint32_t last_cost = 0;
+static Rect repainted[STRATEGY_MAX_REPAINTED];
+static int repainted_count = -1;
+static uint32_t band_buffer[MAX_BAND_ROWS * SCREEN_FB_WIDTH];
+
+static const Rect full_screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+static const char *strategy_names[STRATEGY_COUNT] = {
+    "reuse",
+    "incremental",
+    "solid-fill",
+    "row-replicate",
+    "rle-cache",
+    "rasterize",
+};
+
+void strategy_init(void) {
+    memset(stats, 0, sizeof(stats));
+    strategy_invalidate_buffers();
+}
+
+void strategy_invalidate_buffers(void) {
+    memset(buffers, 0, sizeof(buffers));
+}
+
+void strategy_mark_overlay(int buffer, const Rect *r) {
+    BufferContent *content = &buffers[buffer];
+    if (content->overlay_count >= MAX_OVERLAY_RECTS) {
+        // Too many to track: the next frame repaints everything
+        content->valid = 0;
+        return;
+    }
+    content->overlays[content->overlay_count++] = *r;
+    content->fingerprinted = 0;
+}
+
+int strategy_buffer_shows(int buffer, int pattern, const PatternArgs *args, int state) {
+    const BufferContent *content = &buffers[buffer];
+    return content->valid && content->overlay_count == 0 && content->pattern == pattern &&
+           content->state == state && memcmp(&content->args, args, sizeof(*args)) == 0;
+}
+
+static uint64_t buffer_checksum(const uint32_t *pixels) {
+    uint32_t sum[2] = {0, 0};
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        checksum_span(pixels + y * SCREEN_FB_WIDTH, SCREEN_WIDTH, sum);
+    }
+    return checksum_value(sum);
+}
+
+void strategy_fingerprint_buffer(int buffer, const uint32_t *pixels) {
+    BufferContent *content = &buffers[buffer];
+    if (!content->valid) return;
+    content->fingerprint = buffer_checksum(pixels);
+    content->fingerprinted = 1;
+}
+
+int strategy_check_buffer(int buffer, const uint32_t *pixels) {
+    BufferContent *content = &buffers[buffer];
+    if (!content->valid) return 0;
+    if (!content->fingerprinted || buffer_checksum(pixels) != content->fingerprint) {
+        memset(content, 0, sizeof(*content));
+        return 1;
+    }
+    return 0;
+}
+
+int strategy_repainted(const Rect **rects) {
+    *rects = repainted;
+    return repainted_count;
+}
+
+uint32_t strategy_last_cost(void) {
+    return last_cost;
+}
+
+const char *strategy_name(RenderStrategy strategy) {
+    return strategy_names[strategy];
+}
+
+const StrategyStats *strategy_stats(int pattern, RenderStrategy strategy) {
+    return &stats[pattern][strategy];
+}
+
+// Rows per replicated band, or 0 if the pattern does not repeat vertically
+static int band_rows(const PatternDesc *desc) {
+    PatternArgs args;
+    int tile_w, tile_h;
+    
+    if (desc->flags & PATTERN_ROWS_SAME) return 1;
+    if (!(desc->flags & PATTERN_TILEABLE)) return 0;
+    
+    pattern_default_args(desc, &args);
+    pattern_tile_size(desc, &args, &tile_w, &tile_h);
+    return (tile_h > 0 && tile_h <= MAX_BAND_ROWS) ? tile_h : 0;
+}
+
+static int cacheable(int pattern) {
+    return !cache_failed[pattern] && pattern_get(pattern)->cycle <= MAX_CACHED_STATES;
+}
+
+int strategy_applicable(int pattern, RenderStrategy strategy) {
+    const PatternDesc *desc = pattern_get(pattern);
+    switch (strategy) {
+        case STRATEGY_REUSE:
+            return 1;
+        case STRATEGY_INCREMENTAL:
+            return desc->changed_rects != NULL;
+        case STRATEGY_SOLID_FILL:
+            return (desc->flags & PATTERN_SOLID) != 0;
+        case STRATEGY_ROW_REPLICATE:
+            return band_rows(desc) > 0;
+        case STRATEGY_RLE_CACHE:
+            return cacheable(pattern);
+        case STRATEGY_RASTERIZE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void repaint_rects(uint32_t *pixels, const PatternDesc *desc, const PatternArgs *args,
+                          int state, const Rect *rects, int count) {
+    for (int i = 0; i < count; i++) {
+        Rect r = rects[i];
+        if (r.x0 < 0) r.x0 = 0;
+        if (r.y0 < 0) r.y0 = 0;
+        if (r.x1 > SCREEN_WIDTH) r.x1 = SCREEN_WIDTH;
+        if (r.y1 > SCREEN_HEIGHT) r.y1 = SCREEN_HEIGHT;
+        if (r.x0 < r.x1 && r.y0 < r.y1) {
+            pattern_render(pixels, &r, desc, args, state);
+        }
+    }
+}
+
+static void render_row_replicate(uint32_t *pixels, const PatternDesc *desc,
+                                 const PatternArgs *args, int state) {
+    // The band is rasterized into cached LPDDR, then streamed into CDRAM
+    int rows = band_rows(desc);
+    Rect band = {0, 0, SCREEN_WIDTH, rows};
+    pattern_render(band_buffer, &band, desc, args, state);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        memcpy(pixels + y * SCREEN_FB_WIDTH, band_buffer + (y % rows) * SCREEN_FB_WIDTH,
+               SCREEN_WIDTH * sizeof(uint32_t));
+    }
+}
+
+static void render_rle_cache(uint32_t *pixels, int pattern, const PatternDesc *desc,
+                             const PatternArgs *args, int state) {
+    uint32_t key = FRAME_CACHE_KEY(pattern, state);
+    const RleFrame *cached = frame_cache_find(key);
+    if (cached) {
+        rle_decode(cached, pixels, SCREEN_FB_WIDTH);
+        return;
+    }
+    
+    bands_render(pixels, &full_screen, desc, args, state);
+    if (!frame_cache_store(key, pixels, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_FB_WIDTH)) {
+        cache_failed[pattern] = 1;
+        evlog_printf("strategy: '%s' does not fit the frame cache", desc->name);
+    }
+}
+
+// Pick among the full-frame strategies: explore first, then cheapest
+static RenderStrategy choose_full_frame(int pattern, int allow_cache) {
+    RenderStrategy best = STRATEGY_RASTERIZE;
+    uint32_t best_cost = 0xFFFFFFFF;
+    
+    for (int s = STRATEGY_SOLID_FILL; s < STRATEGY_COUNT; s++) {
+        if (!strategy_applicable(pattern, s)) continue;
+        if (s == STRATEGY_RLE_CACHE && !allow_cache) continue;
+        if (stats[pattern][s].samples < MIN_SAMPLES) return s;
+    }
+    
+    for (int s = STRATEGY_SOLID_FILL; s < STRATEGY_COUNT; s++) {
+        if (!strategy_applicable(pattern, s)) continue;
+        if (s == STRATEGY_RLE_CACHE && !allow_cache) continue;
+        uint32_t cost = stats[pattern][s].cost_us;
+        if (cost < best_cost) {
+            best = s;
+            best_cost = cost;
+        }
+    }
+    
+    if (best_cost > STRATEGY_VBLANK_BUDGET_US && stats[pattern][best].samples == MIN_SAMPLES) {
+        evlog_printf("strategy: '%s' over budget, best is %s at %u us",
+                     pattern_get(pattern)->name, strategy_names[best], (unsigned)best_cost);
+    }
+    return best;
+}
+
+static void record(int pattern, RenderStrategy strategy, uint32_t cost) {
+    StrategyStats *st = &stats[pattern][strategy];
+    if (st->samples == 0) {
+        st->cost_us = cost;
+    } else {
+        // Exponential moving average, 1/4 weight for the new sample
+        st->cost_us = (st->cost_us * 3 + cost) / 4;
+    }
+    st->samples++;
+}
+
+static int default_args(const PatternDesc *desc, const PatternArgs *args) {
+    PatternArgs defaults;
+    pattern_default_args(desc, &defaults);
+    return memcmp(&defaults, args, sizeof(defaults)) == 0;
+}
+
+RenderStrategy strategy_render(int buffer, uint32_t *pixels, int pattern,
+                               const PatternArgs *args, int state) {
+    const PatternDesc *desc = pattern_get(pattern);
+    BufferContent *content = &buffers[buffer];
+    int same_pattern = content->valid && content->pattern == pattern &&
+                       memcmp(&content->args, args, sizeof(*args)) == 0;
+    RenderStrategy strategy;
+    Rect changed[MAX_CHANGED_RECTS];
+    int changed_count = -1;
+    uint64_t start = sceKernelGetProcessTimeWide();
+    
+    if (same_pattern && content->state == state) {
+        strategy = STRATEGY_REUSE;
+    } else if (same_pattern && desc->changed_rects &&
+               (changed_count = desc->changed_rects(content->state, state,
+                                                    changed, MAX_CHANGED_RECTS)) >= 0) {
+        strategy = STRATEGY_INCREMENTAL;
+    } else {
+        // Cached frames are keyed by state only, so they assume default arguments
+        strategy = choose_full_frame(pattern, default_args(desc, args));
+    }
+    
+    switch (strategy) {
+        case STRATEGY_REUSE:
+            repaint_rects(pixels, desc, args, state, content->overlays, content->overlay_count);
+            break;
+        case STRATEGY_INCREMENTAL:
+            repaint_rects(pixels, desc, args, state, changed, changed_count);
+            repaint_rects(pixels, desc, args, state, content->overlays, content->overlay_count);
+            break;
+        case STRATEGY_SOLID_FILL:
+            fill_span(pixels, desc->solid_color(args, state), SCREEN_FB_WIDTH * SCREEN_HEIGHT);
+            break;
+        case STRATEGY_ROW_REPLICATE:
+            render_row_replicate(pixels, desc, args, state);
+            break;
+        case STRATEGY_RLE_CACHE:
+            render_rle_cache(pixels, pattern, desc, args, state);
+            break;
+        default:
+            bands_render(pixels, &full_screen, desc, args, state);
+            break;
+    }
+    
+    last_cost = (uint32_t)(sceKernelGetProcessTimeWide() - start);
+    record(pattern, strategy, last_cost);
+    
+    repainted_count = -1;
+    if (strategy == STRATEGY_REUSE || strategy == STRATEGY_INCREMENTAL) {
+        repainted_count = 0;
+        for (int i = 0; strategy == STRATEGY_INCREMENTAL && i < changed_count; i++) {
+            repainted[repainted_count++] = changed[i];
+        }
+        for (int i = 0; i < content->overlay_count; i++) {
+            repainted[repainted_count++] = content->overlays[i];
+        }
+    }
+    
+    content->valid = 1;
+    content->pattern = pattern;
+    content->args = *args;
+    content->state = state;
+    content->overlay_count = 0;
+    content->fingerprinted = 0;
+    return strategy;
+}
+
+void strategy_prewarm_cache(void) {
+    if (frame_cache_init() < 0) {
+        evlog_printf("cache: arena allocation failed, patterns will be rasterized");
+        return;
+    }
+    
+    uint32_t *scratch = malloc(SCREEN_FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!scratch) return;
+    
+    for (int p = 0; p < pattern_count(); p++) {
+        const PatternDesc *desc = pattern_get(p);
+        PatternArgs args;
+        if (!cacheable(p)) continue;
+        
+        pattern_default_args(desc, &args);
+        for (int state = 0; state < desc->cycle; state++) {
+            pattern_render(scratch, &full_screen, desc, &args, state);
+            if (!frame_cache_store(FRAME_CACHE_KEY(p, state), scratch,
+                                   SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_FB_WIDTH)) {
+                cache_failed[p] = 1;
+            }
+        }
+    }
+    free(scratch);
+    
+    int count;
+    uint32_t bytes;
+    frame_cache_stats(&count, &bytes);
+    evlog_printf("cache: %d frames in %u bytes", count, (unsigned)bytes);
+}
@@ -0,0 +1,79 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <stdint.h>
+#include "display.h"
+#include "patterns.h"
+
+// Adaptive render strategies.
+//
+// Each pattern can be produced several ways. The selector times every
+// applicable strategy for a pattern at runtime and then keeps using the
+// cheapest one that fits the vblank budget and the cache memory limit.
+// It also tracks what each of the two framebuffers currently holds, so a
+// buffer that already shows the right frame is only touched where
+// overlays were drawn on top of it.
+
+typedef enum {
+    STRATEGY_REUSE,          // Buffer already holds this state: restore overlay areas only
+    STRATEGY_INCREMENTAL,    // Same pattern, other state: repaint changed rects only
+    STRATEGY_SOLID_FILL,     // Whole buffer is one color
+    STRATEGY_ROW_REPLICATE,  // Rasterize one row (or tile band), copy it down the screen
+    STRATEGY_RLE_CACHE,      // Expand a compressed frame from the frame cache
+    STRATEGY_RASTERIZE,      // Run the pattern's painter over the whole screen
+    STRATEGY_COUNT
+} RenderStrategy;
+
+#define STRATEGY_VBLANK_BUDGET_US SCREEN_REFRESH_US
+
+// Most areas a partial repaint touches (changed rects plus overlays)
+#define STRATEGY_MAX_REPAINTED 8
+
+typedef struct {
+    uint32_t cost_us;      // Smoothed render cost
+    uint32_t samples;
+} StrategyStats;
+
+// Reset selection statistics and buffer tracking. Patterns the startup
+// prewarm found not to fit the frame cache stay excluded from it.
+void strategy_init(void);
+
+// Forget what both framebuffers hold (e.g. after drawing something else)
+void strategy_invalidate_buffers(void);
+
+// Checksum what `buffer` holds now, so strategy_check_buffer() can tell
+// later whether the pixels survived (e.g. a system suspend)
+void strategy_fingerprint_buffer(int buffer, const uint32_t *pixels);
+
+// Forget what `buffer` holds unless it still matches its fingerprint, so
+// the next render repaints it in full; returns 1 if its content was lost
+int strategy_check_buffer(int buffer, const uint32_t *pixels);
+
+// Draw a state of registry pattern `pattern` into framebuffer `buffer` (0 or 1)
+RenderStrategy strategy_render(int buffer, uint32_t *pixels, int pattern,
+                               const PatternArgs *args, int state);
+
+// Record that an overlay was drawn over r in `buffer` since the last render
+void strategy_mark_overlay(int buffer, const Rect *r);
+
+// Non-zero if `buffer` holds this state of the pattern with no overlay
+// areas waiting for repair
+int strategy_buffer_shows(int buffer, int pattern, const PatternArgs *args, int state);
+
+// Areas the last strategy_render() call repainted; returns how many, or
+// -1 if it redrew the whole buffer
+int strategy_repainted(const Rect **rects);
+
+// Cost of the last strategy_render() call in microseconds
+uint32_t strategy_last_cost(void);
+
+const char *strategy_name(RenderStrategy strategy);
+const StrategyStats *strategy_stats(int pattern, RenderStrategy strategy);
+
+// Non-zero if the strategy can be used for this pattern at all
+int strategy_applicable(int pattern, RenderStrategy strategy);
+
+// Startup task: compress every state of patterns with few states
+void strategy_prewarm_cache(void);
+
+#endif
@@ -0,0 +1,137 @@
+#include "suspend.h"
+#include "evlog.h"
+#include "storage.h"
+
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/power.h>
+
+#define RESUME_FILE_MAGIC 0x454D5352   // "RSME"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+} ResumeFileHeader;
+
+static SceUID callback_thread = -1;
+static SceUID resumed_sema = -1;
+
+// Written by the callback thread, read by the main thread
+static uint32_t suspend_seq = 0;
+static uint32_t resume_seq = 0;
+static uint64_t suspend_time = 0;
+static uint64_t resume_time = 0;
+
+// Main thread only
+static uint32_t handled_suspend = 0;
+static uint32_t handled_resume = 0;
+static uint64_t last_duration = 0;
+
+static int power_callback(int notify_id, int notify_count, int notify_arg, void *common) {
+    (void)notify_id; (void)notify_count; (void)common;
+    uint64_t now = sceKernelGetSystemTimeWide();
+
+    // Both can arrive in one call if the thread did not run in between
+    if (notify_arg & SCE_POWER_CB_SUSPENDING) {
+        __atomic_store_n(&suspend_time, now, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&suspend_seq, 1, __ATOMIC_RELEASE);
+    }
+    if (notify_arg & SCE_POWER_CB_RESUME_COMPLETE) {
+        __atomic_store_n(&resume_time, now, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&resume_seq, 1, __ATOMIC_RELEASE);
+        sceKernelSignalSema(resumed_sema, 1);
+    }
+    return 0;
+}
+
+static int callback_main(SceSize args, void *argp) {
+    (void)args; (void)argp;
+    SceUID cb = sceKernelCreateCallback("power_cb", 0, power_callback, NULL);
+    if (cb < 0 || scePowerRegisterCallback(cb) < 0) {
+        evlog_printf("suspend: power callback unavailable");
+        return 0;
+    }
+    // Callbacks only run while their thread waits in a CB function
+    for (;;) {
+        sceKernelSleepThreadCB();
+    }
+    return 0;
+}
+
+int suspend_init(void) {
+    resumed_sema = sceKernelCreateSema("resumed", 0, 0, 1, NULL);
+    if (resumed_sema < 0) return -1;
+
+    callback_thread = sceKernelCreateThread("power_callbacks", callback_main,
+                                            SCE_KERNEL_HIGHEST_PRIORITY_USER, 0x4000, 0,
+                                            SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (callback_thread < 0 || sceKernelStartThread(callback_thread, 0, NULL) < 0) {
+        sceKernelDeleteSema(resumed_sema);
+        resumed_sema = -1;
+        return -1;
+    }
+    return 0;
+}
+
+SuspendEvent suspend_poll(void) {
+    uint32_t suspends = __atomic_load_n(&suspend_seq, __ATOMIC_ACQUIRE);
+    uint32_t resumes = __atomic_load_n(&resume_seq, __ATOMIC_ACQUIRE);
+
+    if (suspends != handled_suspend) {
+        handled_suspend = suspends;
+        if (resumes == handled_resume) return SUSPEND_ENTERING;
+    }
+    if (resumes != handled_resume) {
+        handled_resume = resumes;
+        uint64_t from = __atomic_load_n(&suspend_time, __ATOMIC_RELAXED);
+        uint64_t to = __atomic_load_n(&resume_time, __ATOMIC_RELAXED);
+        last_duration = (from != 0 && to > from) ? to - from : 0;
+        return SUSPEND_RESUMED;
+    }
+    return SUSPEND_NONE;
+}
+
+int suspend_wait_resume(uint32_t timeout_us) {
+    if (resumed_sema < 0) return 0;
+    // The semaphore may hold a signal from a resume that was already polled
+    while (__atomic_load_n(&resume_seq, __ATOMIC_ACQUIRE) == handled_resume) {
+        SceUInt timeout = timeout_us;
+        if (sceKernelWaitSema(resumed_sema, 1, &timeout) < 0) return 0;
+    }
+    return 1;
+}
+
+uint64_t suspend_last_duration(void) {
+    return last_duration;
+}
+
+int suspend_save_state(const void *state, uint32_t size) {
+    ResumeFileHeader header = {.magic = RESUME_FILE_MAGIC, .size = size};
+    char path[128];
+    storage_path(path, sizeof(path), "resume.bin");
+    SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) return -1;
+    int ok = sceIoWrite(fd, &header, sizeof(header)) == (int)sizeof(header) &&
+             sceIoWrite(fd, state, size) == (int)size;
+    sceIoClose(fd);
+    return ok ? 0 : -1;
+}
+
+int suspend_load_state(void *state, uint32_t size) {
+    ResumeFileHeader header;
+    char path[128];
+    storage_path(path, sizeof(path), "resume.bin");
+    SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+    if (fd < 0) return -1;
+    int ok = sceIoRead(fd, &header, sizeof(header)) == (int)sizeof(header) &&
+             header.magic == RESUME_FILE_MAGIC && header.size == size &&
+             sceIoRead(fd, state, size) == (int)size;
+    sceIoClose(fd);
+    return ok ? 0 : -1;
+}
+
+void suspend_clear_state(void) {
+    char path[128];
+    storage_path(path, sizeof(path), "resume.bin");
+    sceIoRemove(path);
+}
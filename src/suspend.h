@@ -0,0 +1,50 @@
+#ifndef SUSPEND_H
+#define SUSPEND_H
+
+#include <stdint.h>
+
+// Suspend/resume handling.
+//
+// A callback thread receives the system's power notifications and only
+// records them; the main loop picks them up with suspend_poll() at the top
+// of a frame, where nothing is half drawn. On SUSPEND_ENTERING the app
+// saves what it needs to carry on, then parks in suspend_wait_resume() so
+// no frame is rendered or counted while the screen is off. On
+// SUSPEND_RESUMED it checks what survived and continues from the saved
+// state.
+
+typedef enum {
+    SUSPEND_NONE,
+    SUSPEND_ENTERING,   // The system is about to sleep: save state now
+    SUSPEND_RESUMED,    // The system woke up: validate and restore
+} SuspendEvent;
+
+// Longest suspend_wait_resume() waits for a sleep that may not come
+#define SUSPEND_WAIT_US 10000000
+
+// Register for power notifications; returns < 0 if they are unavailable
+int suspend_init(void);
+
+// Next power event to act on, oldest first. A resume whose suspend was
+// never reported (the system slept before the app saw it) comes back as
+// SUSPEND_RESUMED alone.
+SuspendEvent suspend_poll(void);
+
+// Block until the system has resumed or timeout_us passed; returns 1 if a
+// resume was seen. The following suspend_poll() reports it.
+int suspend_wait_resume(uint32_t timeout_us);
+
+// Length of the last suspend, measured by the system clock from the
+// suspend notification to the resume notification (0 if unknown)
+uint64_t suspend_last_duration(void);
+
+// Write a state snapshot to APP_DATA_DIR/resume.bin; it stays there until
+// suspend_clear_state(), so a session that never woke up can be told apart
+int suspend_save_state(const void *state, uint32_t size);
+
+// Read the snapshot back; returns 0 if a snapshot of this size exists
+int suspend_load_state(void *state, uint32_t size);
+
+void suspend_clear_state(void);
+
+#endif
@@ -0,0 +1,76 @@
+#include "timecode.h"
+#include "span.h"
+
+#define SYNC_BITS 0x5                // 1 0 1
+#define DATA_BITS (TIMECODE_FRAME_BITS + TIMECODE_PATTERN_BITS + 1)
+
+#define STRIP_WIDTH  (TIMECODE_CELLS * TIMECODE_CELL_SIZE + 2 * TIMECODE_BORDER)
+#define STRIP_HEIGHT (TIMECODE_CELL_SIZE + 2 * TIMECODE_BORDER)
+#define STRIP_X      (SCREEN_WIDTH - STRIP_WIDTH - 8)
+#define STRIP_Y      8
+
+_Static_assert(TIMECODE_CELLS <= 32, "cells must fit a uint32_t");
+
+static uint32_t encode(uint32_t frame, int pattern) {
+    uint32_t frame_mask = (1u << TIMECODE_FRAME_BITS) - 1;
+    uint32_t pattern_mask = (1u << TIMECODE_PATTERN_BITS) - 1;
+    uint32_t gray = (frame ^ (frame >> 1)) & frame_mask;
+    uint32_t data = (gray << TIMECODE_PATTERN_BITS) | ((uint32_t)pattern & pattern_mask);
+    uint32_t parity = __builtin_popcount(data) & 1;
+    return (SYNC_BITS << DATA_BITS) | (data << 1) | parity;
+}
+
+static void fill_cell(uint32_t *pixels, int cell, int on) {
+    uint32_t color = on ? COLOR_WHITE : COLOR_BLACK;
+    int x = STRIP_X + TIMECODE_BORDER + cell * TIMECODE_CELL_SIZE;
+    for (int y = 0; y < TIMECODE_CELL_SIZE; y++) {
+        fill_span(pixels + (STRIP_Y + TIMECODE_BORDER + y) * SCREEN_FB_WIDTH + x, color, TIMECODE_CELL_SIZE);
+    }
+}
+
+Rect timecode_area(void) {
+    Rect r = {STRIP_X, STRIP_Y, STRIP_X + STRIP_WIDTH, STRIP_Y + STRIP_HEIGHT};
+    return r;
+}
+
+void timecode_draw(uint32_t *pixels, uint32_t frame, int pattern) {
+    uint32_t code = encode(frame, pattern);
+
+    // Border rows and columns, then every cell
+    for (int y = STRIP_Y; y < STRIP_Y + STRIP_HEIGHT; y++) {
+        uint32_t *row = pixels + y * SCREEN_FB_WIDTH;
+        if (y < STRIP_Y + TIMECODE_BORDER || y >= STRIP_Y + STRIP_HEIGHT - TIMECODE_BORDER) {
+            fill_span(row + STRIP_X, COLOR_BLACK, STRIP_WIDTH);
+        } else {
+            fill_span(row + STRIP_X, COLOR_BLACK, TIMECODE_BORDER);
+            fill_span(row + STRIP_X + STRIP_WIDTH - TIMECODE_BORDER, COLOR_BLACK, TIMECODE_BORDER);
+        }
+    }
+    for (int cell = 0; cell < TIMECODE_CELLS; cell++) {
+        uint32_t bit = 1u << (TIMECODE_CELLS - 1 - cell);
+        fill_cell(pixels, cell, (code & bit) != 0);
+    }
+}
+
+int timecode_read(const uint32_t *pixels, int pitch, uint32_t *frame, int *pattern) {
+    uint32_t code = 0;
+    int y = STRIP_Y + TIMECODE_BORDER + TIMECODE_CELL_SIZE / 2;
+    for (int cell = 0; cell < TIMECODE_CELLS; cell++) {
+        int x = STRIP_X + TIMECODE_BORDER + cell * TIMECODE_CELL_SIZE + TIMECODE_CELL_SIZE / 2;
+        uint32_t green = (pixels[y * pitch + x] >> 8) & 0xFF;
+        code = (code << 1) | (green >= 128);
+    }
+
+    if ((code >> DATA_BITS) != SYNC_BITS) return -1;
+    uint32_t data = code & ((1u << DATA_BITS) - 1);
+    if (__builtin_popcount(data) & 1) return -1;
+
+    uint32_t gray = data >> (1 + TIMECODE_PATTERN_BITS);
+    uint32_t value = gray;
+    for (uint32_t shift = 1; shift < TIMECODE_FRAME_BITS; shift <<= 1) {
+        value ^= value >> shift;
+    }
+    *frame = value;
+    *pattern = (int)((data >> 1) & ((1u << TIMECODE_PATTERN_BITS) - 1));
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef TIMECODE_H
+#define TIMECODE_H
+
+#include <stdint.h>
+#include "display.h"
+
+// Binary timecode strip.
+//
+// A row of TIMECODE_CELLS square cells in the top right corner, white for
+// 1 and black for 0, inside a black border, so a high-speed camera can
+// tell every displayed frame apart and spot drops and repeats. Left to
+// right the cells hold:
+//
+//   1 0 1                       sync marker
+//   TIMECODE_FRAME_BITS         displayed frame number, Gray coded, MSB first
+//   TIMECODE_PATTERN_BITS       registry pattern id, MSB first
+//   1 parity cell               makes the count of 1 cells after the sync even
+//
+// Consecutive frame numbers differ in one frame cell (and the parity
+// cell), so a camera exposure that straddles a flip is off by one frame at
+// most instead of decoding to garbage. The frame number matches the frame
+// column of history dumps.
+
+#define TIMECODE_FRAME_BITS   20
+#define TIMECODE_PATTERN_BITS 6
+#define TIMECODE_CELLS        (3 + TIMECODE_FRAME_BITS + TIMECODE_PATTERN_BITS + 1)
+#define TIMECODE_CELL_SIZE    12
+#define TIMECODE_BORDER       2
+
+// Screen area the strip covers
+Rect timecode_area(void);
+
+// Draw the strip over timecode_area() of a screen-sized buffer
+void timecode_draw(uint32_t *pixels, uint32_t frame, int pattern);
+
+// Decode a strip from a screen with the given pitch; returns 0 if the sync
+// marker and parity check out
+int timecode_read(const uint32_t *pixels, int pitch, uint32_t *frame, int *pattern);
+
+#endif